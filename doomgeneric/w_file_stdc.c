@@ -21,6 +21,7 @@
 #include "z_zone.h"
 
 #include <stdio.h>
+#include <unistd.h>
 
 typedef struct {
     wad_file_t wad;
@@ -64,19 +65,15 @@ static void W_StdC_CloseFile(wad_file_t* wad) {
 
 size_t W_StdC_Read(wad_file_t* wad, unsigned int offset, void* buffer, size_t buffer_len) {
     stdc_wad_file_t* stdc_wad;
-    size_t result;
+    ssize_t result;
 
     stdc_wad = (stdc_wad_file_t*) wad;
 
-    // Jump to the specified position in the file.
+    // Read from the specified position in the file, in a single system call.
 
-    fseek(stdc_wad->fstream, offset, SEEK_SET);
+    result = pread(fileno(stdc_wad->fstream), buffer, buffer_len, offset);
 
-    // Read into the buffer.
-
-    result = fread(buffer, 1, buffer_len, stdc_wad->fstream);
-
-    return result;
+    return result < 0 ? 0 : result;
 }
 
 wad_file_class_t stdc_wad_file = {
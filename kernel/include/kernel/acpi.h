@@ -0,0 +1,47 @@
+#pragma once
+
+#include <kernel/multiboot2.h>
+
+#include <stdint.h>
+
+#define ACPI_SIG_MADT "APIC"
+
+#define MADT_TYPE_LAPIC 0
+#define MADT_LAPIC_ENABLED (1 << 0)
+#define MADT_LAPIC_ONLINE_CAPABLE (1 << 1)
+
+// Header common to all system description tables
+typedef struct {
+    char signature[4];
+    uint32_t length;
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__ ((packed)) acpi_sdt_header_t;
+
+// The MADT describes interrupt controllers, including each CPU's local APIC
+typedef struct {
+    acpi_sdt_header_t header;
+    uint32_t lapic_addr;
+    uint32_t flags;
+    uint8_t entries[];
+} __attribute__ ((packed)) acpi_madt_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t length;
+} __attribute__ ((packed)) acpi_madt_entry_t;
+
+typedef struct {
+    acpi_madt_entry_t header;
+    uint8_t acpi_id;
+    uint8_t lapic_id;
+    uint32_t flags;
+} __attribute__ ((packed)) acpi_madt_lapic_t;
+
+void init_acpi(mb2_t* boot);
+acpi_sdt_header_t* acpi_find_table(const char* signature);
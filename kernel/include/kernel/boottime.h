@@ -0,0 +1,10 @@
+#pragma once
+
+#include <kernel/uapi/uapi_syscall.h>
+
+#include <stdint.h>
+
+void init_boottime();
+void boottime_mark(const char* name);
+void boottime_done(const char* name);
+uint32_t boottime_get_phases(boot_phase_t* phases);
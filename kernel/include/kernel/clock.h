@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void init_clock();
+uint64_t clock_get_ns();
+uint64_t clock_cycles_to_ns(uint64_t cycles);
+bool clock_get_tsc_params(uint64_t* base, uint64_t* mult);
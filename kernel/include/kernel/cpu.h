@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CPUID_FEAT_EDX_TSC  (1 << 4)
+#define CPUID_FEAT_EDX_MSR  (1 << 5)
+#define CPUID_FEAT_EDX_APIC (1 << 9)
+#define CPUID_FEAT_EDX_SEP  (1 << 11)
+
+#define MSR_APIC_BASE     0x1B
+#define MSR_SYSENTER_CS  0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+
+typedef struct {
+    uint32_t eax, ebx, ecx, edx;
+} cpuid_t;
+
+cpuid_t cpu_cpuid(uint32_t leaf);
+bool cpu_has_feature_edx(uint32_t feature);
+uint64_t cpu_rdmsr(uint32_t msr);
+void cpu_wrmsr(uint32_t msr, uint64_t value);
+uint64_t cpu_rdtsc();
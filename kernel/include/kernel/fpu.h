@@ -1,10 +1,17 @@
 #pragma once
 
 #include <kernel/proc.h>
+#include <kernel/isr.h>
 
 #include <stdint.h>
 
 void init_fpu();
+void fpu_init_ap();
 void fpu_switch(process_t* prev, const process_t* next);
+void fpu_save(process_t* proc);
+void fpu_restore(const process_t* proc);
+void fpu_init_process(process_t* proc);
+void fpu_release(const process_t* proc);
+bool fpu_is_loaded(const process_t* proc);
 void fpu_kernel_enter();
-void fpu_kernel_exit();
\ No newline at end of file
+void fpu_kernel_exit(registers_t* regs);
\ No newline at end of file
@@ -42,6 +42,8 @@ typedef struct fs_t {
     int32_t (*unlink)(struct fs_t*, uint32_t, uint32_t);
     uint32_t (*read)(struct fs_t*, uint32_t, uint32_t, uint8_t*, uint32_t);
     uint32_t (*append)(struct fs_t*, uint32_t, uint8_t*, uint32_t);
+    /* Writes at a given offset, optional */
+    uint32_t (*write)(struct fs_t*, uint32_t, uint32_t, uint8_t*, uint32_t);
     /* TODO: require null termination of entries */
     sos_directory_entry_t* (*readdir)(struct fs_t*, uint32_t, uint32_t);
     inode_t* (*get_fs_inode)(struct fs_t*, uint32_t);
@@ -52,6 +54,7 @@ typedef struct fs_t {
 typedef inode_t* (*fs_get_fs_inode_t)(struct fs_t*, uint32_t);
 typedef sos_directory_entry_t* (*fs_readdir_t)(struct fs_t*, uint32_t, uint32_t);
 typedef uint32_t (*fs_append_t)(struct fs_t*, uint32_t, uint8_t*, uint32_t);
+typedef uint32_t (*fs_write_t)(struct fs_t*, uint32_t, uint32_t, uint8_t*, uint32_t);
 typedef uint32_t (*fs_read_t)(struct fs_t*, uint32_t, uint32_t, uint8_t*, uint32_t);
 typedef int32_t (*fs_unlink_t)(struct fs_t*, uint32_t, uint32_t);
 typedef int32_t (*fs_rename_t)(struct fs_t*, uint32_t, uint32_t, uint32_t);
@@ -69,5 +72,6 @@ int32_t fs_rename(const char* oldp, const char* newp);
 int32_t fs_close(inode_t* in);
 uint32_t fs_read(inode_t* in, uint32_t offset, uint8_t* buf, uint32_t size);
 uint32_t fs_write(inode_t* in, uint8_t* buf, uint32_t size);
+uint32_t fs_pwrite(inode_t* in, uint32_t offset, uint8_t* buf, uint32_t size);
 uint32_t fs_readdir(inode_t* in, uint32_t offset, sos_directory_entry_t* d_ent, uint32_t size);
 int32_t fs_stat(const char* path, stat_t* buf);
\ No newline at end of file
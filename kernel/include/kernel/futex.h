@@ -0,0 +1,11 @@
+#pragma once
+
+#include <kernel/uapi/uapi_futex.h>
+
+#include <stdint.h>
+
+#define FUTEX_HASH_BITS 6 // The table has 2^FUTEX_HASH_BITS wait queues
+
+void init_futex();
+int32_t futex_wait(volatile uint32_t* addr, uint32_t val, uint32_t timeout);
+int32_t futex_wake(volatile uint32_t* addr, uint32_t count);
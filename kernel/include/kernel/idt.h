@@ -28,4 +28,5 @@ typedef struct {
 } __attribute__ ((packed)) idt_pointer_t;
 
 void init_idt();
+void idt_load();
 void idt_set_entry(uint8_t num, uint32_t base, uint16_t selector, uint8_t flags);
\ No newline at end of file
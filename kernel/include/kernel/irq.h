@@ -2,9 +2,35 @@
 
 #include <kernel/isr.h>
 
+#include <stdint.h>
+
 #define CLI() asm volatile("cli")
 #define STI() asm volatile("sti")
 
+#define EFLAGS_IF (1 << 9)
+
+/* Disables interrupts, and returns the previous EFLAGS for `irq_restore`.
+ */
+static inline uint32_t irq_save() {
+    uint32_t eflags;
+
+    asm volatile (
+        "pushf\n"
+        "pop %0\n"
+        "cli\n"
+        : "=r" (eflags) :: "memory");
+
+    return eflags;
+}
+
+/* Enables interrupts again if they were enabled when `irq_save` was called.
+ */
+static inline void irq_restore(uint32_t eflags) {
+    if (eflags & EFLAGS_IF) {
+        asm volatile ("sti" ::: "memory");
+    }
+}
+
 void init_irq();
 void irq_handler(registers_t* regs);
 void irq_send_eoi(uint8_t irq);
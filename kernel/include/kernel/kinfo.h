@@ -0,0 +1,10 @@
+#pragma once
+
+#include <kernel/uapi/uapi_kinfo.h>
+#include <kernel/timer.h>
+
+/* Maximum age of the page while a process runs, in ticks, see `proc_set_next_tick` */
+#define KINFO_MAX_AGE (TIMER_FREQ / 10)
+
+void init_kinfo();
+void kinfo_update();
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LAPIC_TIMER_VECTOR    64 // One-shot ticks of the boot processor
+#define LAPIC_TICK_VECTOR     65 // Periodic ticks of application processors
+#define LAPIC_RESCHED_VECTOR  66 // Sent to a CPU so that it runs its scheduler
+#define LAPIC_SPURIOUS_VECTOR 255
+
+// Register offsets from the LAPIC's base address
+#define LAPIC_ID           0x020
+#define LAPIC_TPR          0x080
+#define LAPIC_EOI          0x0B0
+#define LAPIC_SVR          0x0F0
+#define LAPIC_ICR_LOW      0x300
+#define LAPIC_ICR_HIGH     0x310
+#define LAPIC_LVT_TIMER    0x320
+#define LAPIC_LVT_LINT0    0x350
+#define LAPIC_LVT_LINT1    0x360
+#define LAPIC_TIMER_INIT   0x380
+#define LAPIC_TIMER_CURR   0x390
+#define LAPIC_TIMER_DIV    0x3E0
+
+#define LAPIC_SVR_ENABLE   (1 << 8)
+#define LAPIC_LVT_MASKED   (1 << 16)
+#define LAPIC_LVT_EXTINT   (7 << 8)
+#define LAPIC_LVT_NMI      (4 << 8)
+#define LAPIC_TIMER_DIV_16 0x3
+#define LAPIC_TIMER_PERIODIC (1 << 17)
+
+// Interrupt command register, used to send inter-processor interrupts
+#define LAPIC_ICR_INIT     (5 << 8)
+#define LAPIC_ICR_STARTUP  (6 << 8)
+#define LAPIC_ICR_PENDING  (1 << 12)
+#define LAPIC_ICR_ASSERT   (1 << 14)
+#define LAPIC_ICR_LEVEL    (1 << 15)
+
+#define MSR_APIC_BASE_ENABLE (1 << 11)
+
+bool init_lapic();
+void lapic_init_ap();
+uint32_t lapic_id();
+void lapic_send_ipi(uint32_t id, uint32_t command);
+void lapic_eoi();
+uint32_t lapic_timer_calibrate(uint32_t ms);
+void lapic_timer_oneshot(uint32_t count);
+void lapic_timer_periodic(uint32_t count);
+uint32_t lapic_timer_current();
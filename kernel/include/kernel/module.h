@@ -0,0 +1,10 @@
+#pragma once
+
+#include <kernel/multiboot2.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void* module_map(mb2_tag_module_t* mod);
+void module_release(mb2_tag_module_t* mod, void* data);
+bool module_release_enabled();
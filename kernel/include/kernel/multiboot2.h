@@ -88,8 +88,9 @@ typedef struct mb2_tag_fb_t {
     /* Color info stuff goes here, but it's tedious & useless */
 } mb2_tag_fb_t __attribute__((packed));
 
-/* TODO: reconsider moving those two once ACPI gets there */
+/* Copies of the ACPI RSDP, the rest of the ACPI structures are in `acpi.h` */
 typedef struct acpi_rsdp1_t {
+    char signature[8];
     uint8_t checksum;
     char oem_id[6];
     uint8_t revision;
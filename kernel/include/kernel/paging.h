@@ -42,9 +42,15 @@ uintptr_t paging_virt_to_phys(uintptr_t virt);
 #define KERNEL_HEAP_BEGIN KERNEL_END_MAP
 #define KERNEL_HEAP_SIZE 0x1E00000
 
+/* GRUB modules are mapped after the kernel heap, see `module.c`.
+ */
+#define KERNEL_MODULES_BEGIN (KERNEL_HEAP_BEGIN + KERNEL_HEAP_SIZE)
+#define KERNEL_MODULES_SIZE 0x4000000
+
 #define PAGE_PRESENT 1
 #define PAGE_RW      2
 #define PAGE_USER    4
+#define PAGE_NOCACHE 16
 #define PAGE_LARGE   128
 
 #define PAGE_FRAME   0xFFFFF000
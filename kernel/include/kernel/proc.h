@@ -1,6 +1,10 @@
 #pragma once
 
 #include <kernel/fs.h>
+#include <kernel/isr.h>
+#include <kernel/uapi/uapi_procstat.h>
+#include <kernel/uapi/uapi_ring.h>
+#include <kernel/uapi/uapi_syscall.h>
 
 #include <list.h>
 #include <stdint.h>
@@ -9,9 +13,13 @@
 #define PROC_STACK_PAGES 4
 #define PROC_KERNEL_STACK_PAGES 1
 #define PROC_MAX_FD 1024
+#define PROC_FIRST_FD 3 // Lower fds are reserved for the standard streams
+#define PROC_INITIAL_FDS 32
 
+/* An open file description, possibly shared by several file descriptors
+ * across processes, see `proc_add_fd`.
+ */
 typedef struct {
-    uint32_t fd;
     inode_t* inode;
     uint32_t mode;
     uint32_t offset;
@@ -20,6 +28,11 @@ typedef struct {
     uint32_t refcount;
 } ft_entry_t;
 
+/* A list of `process_t*` blocked until something happens, see `proc_wait`.
+ * Initialize with `LIST_HEAD_INIT`.
+ */
+typedef list_t wait_queue_t;
+
 // Add new members to the end to avoid messing with the offsets
 typedef struct _proc_t {
     uint32_t pid;
@@ -34,12 +47,50 @@ typedef struct _proc_t {
     // Stack to use when first switching to userspace for a new process
     uintptr_t initial_user_stack;
     uint32_t mem_len; // Size of program heap in bytes
-    uint32_t sleep_ticks;
-    uint8_t fpu_registers[512];
-    list_t filetable;
+    uint32_t wakeup_tick; // Tick at which a sleeping process becomes runnable
+    uint8_t fpu_registers[512] __attribute__((aligned(16))); // For `fxsave`
+    ft_entry_t** fds; // Open files indexed by fd, NULL for unused fds
+    uint32_t* fd_bitmap; // Bit `n` is set if fd `n` is in use
+    uint32_t fd_count; // Size of `fds`, in entries
     char* cwd;
+    uint32_t state;
+    wait_queue_t* wait_queue; // Queue the process is blocked on, if any
+    ring_t* ring; // Submission and completion rings, see `ring.c`
+    uint32_t syscall_counts[SYS_MAX]; // Number of calls to each system call
+    uint64_t syscall_cycles[SYS_MAX]; // Time spent in each, see `systrace.c`
+    bool traced; // Whether to log system calls to the trace buffer
+    bool trace_children; // Whether processes we `exec` are traced
+    uint32_t parent_pid; // 0 once the parent has exited
+    int32_t exit_status; // Valid once the process is a zombie
+    wait_queue_t children_exit; // Where we wait for our children to exit
+    bool kernel_thread; // Runs in ring 0 in the kernel's address space
+    /* The process's main thread, which holds the address space, files, heap
+     * and children shared by its threads; points to itself in the main thread.
+     * Threads have their own pid, used as their thread id. */
+    struct _proc_t* leader;
+    uintptr_t tls; // Thread-local storage pointer, see `proc_get_tls`
+    uintptr_t futex_key; // Word we're blocked on in `futex_wait`, if any
+    char name[PROCSTAT_NAME_MAX]; // Of the executable, shared by threads
+    // Accounting, see `proc_get_stats`
+    uint64_t user_cycles;
+    uint64_t kernel_cycles;
+    uint32_t voluntary_switches;
+    uint32_t involuntary_switches;
+    uint32_t page_faults;
+    uint32_t peak_rss; // In bytes, only kept in the main thread
+    uint32_t cpu; // Whose scheduler knows about the process, see `proc_add`
 } process_t;
 
+/* Possible values of `process_t.state`.
+ * Only runnable processes are known to the scheduler.
+ */
+enum {
+    PROC_RUNNABLE,
+    PROC_SLEEPING,
+    PROC_BLOCKED,
+    PROC_ZOMBIE // Exited, but its parent hasn't collected its exit status
+};
+
 /* This structure defines the interface of schedulers in SnowflakeOS.
  */
 typedef struct _sched_t {
@@ -55,25 +106,79 @@ typedef struct _sched_t {
      * `sched_add`. If the removed process was the one currently executing, the
      * scheduler must ensure that `sched_next` keeps working: it'll be called
      * right after.
+     * Note that the pool may become empty, in which case `sched_next` and
+     * `sched_get_current` must return NULL.
      */
     void (*sched_exit)(struct _sched_t*, process_t*);
+    /* Optional, may be NULL. Hints that a process should be favored for a
+     * while, e.g. because it just received user input.
+     */
+    void (*sched_boost)(struct _sched_t*, process_t*);
+    /* Takes a process out of the pool until `sched_wake` is called on it,
+     * e.g. because it's sleeping. Same requirements as `sched_exit`, but the
+     * scheduler may keep whatever it knows about the process.
+     */
+    void (*sched_block)(struct _sched_t*, process_t*);
+    /* Puts a process blocked by `sched_block` back into the pool.
+     */
+    void (*sched_wake)(struct _sched_t*, process_t*);
+    /* Optional, may be NULL. Returns the number of ticks the current process
+     * may run before `sched_next` should be called again, or 0 if it may run
+     * until something else happens, e.g. because it's alone. Used to program
+     * the timer in tickless mode; defaults to 1.
+     */
+    uint32_t (*sched_slice)(struct _sched_t*);
+    /* Optional, may be NULL. Tells the scheduler that the current process
+     * gives up the rest of its slice, right before `sched_next` is called.
+     * Schedulers that switch on every call to `sched_next` don't need it.
+     */
+    void (*sched_yield)(struct _sched_t*);
 } sched_t;
 
+typedef void (*kthread_entry_t)(void*);
+
+// The process running on the calling CPU
+#define current_process (proc_get_current())
+
 void init_proc();
+void proc_init_ap(uintptr_t stack);
+process_t* proc_get_current();
 process_t* proc_run_code(uint8_t* code, uint32_t size, char** argv);
+process_t* proc_create_kthread(kthread_entry_t entry, void* arg);
 void proc_print_processes();
 void proc_schedule();
-void proc_timer_callback();
-void proc_exit();
+void proc_yield();
+void proc_timer_callback(registers_t* regs);
+void proc_preempt(registers_t* regs);
+void proc_resched(registers_t* regs);
+void proc_account_entry(registers_t* regs);
+void proc_account_exit(registers_t* regs);
+void proc_account_page_fault();
+uint32_t proc_get_stats(procstat_t* buf, uint32_t count);
+void proc_exit(int32_t status);
 void proc_enter_usermode();
-void proc_switch_process(process_t* next);
+void proc_switch_process(process_t* prev, process_t* next);
 uint32_t proc_get_current_pid();
+uint32_t proc_get_current_tid();
+uint32_t proc_get_idle_ticks();
+uint32_t proc_get_cpu_usage();
+process_t* proc_get_process(uint32_t pid);
+void proc_boost(uint32_t pid);
 char* proc_get_cwd();
-void proc_add_fd(ft_entry_t* entry);
+void proc_add_fd(uint32_t fd, ft_entry_t* entry);
 
 void proc_sleep(uint32_t ms);
+void proc_wait(wait_queue_t* queue, uint32_t timeout);
+void proc_wake_all(wait_queue_t* queue);
+void proc_unblock(process_t* p);
 void* proc_sbrk(intptr_t size);
 int32_t proc_exec(const char* path, char** argv);
+int32_t proc_waitpid(int32_t pid, int32_t* status, uint32_t flags);
+int32_t proc_thread_create(uintptr_t entry, uintptr_t stack, uintptr_t tls);
+void proc_thread_exit(int32_t status);
+int32_t proc_thread_join(uint32_t tid, int32_t* status);
+void proc_set_tls(uintptr_t tls);
+uintptr_t proc_get_tls();
 uint32_t proc_open(const char* path, uint32_t flags);
 void proc_close(uint32_t fd);
 uint32_t proc_read(uint32_t fd, uint8_t* buf, uint32_t size);
@@ -81,4 +186,8 @@ int32_t proc_readdir(uint32_t fd, sos_directory_entry_t* dent);
 uint32_t proc_write(uint32_t fd, uint8_t* buf, uint32_t size);
 int32_t proc_fseek(uint32_t fd, int32_t offset, uint32_t whence);
 int32_t proc_ftell(uint32_t fd);
+int32_t proc_readv(uint32_t fd, const iovec_t* iov, uint32_t count);
+int32_t proc_writev(uint32_t fd, const iovec_t* iov, uint32_t count);
+int32_t proc_pread(uint32_t fd, uint8_t* buf, uint32_t size, uint32_t offset);
+int32_t proc_pwrite(uint32_t fd, uint8_t* buf, uint32_t size, uint32_t offset);
 int32_t proc_chdir(const char* path);
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <kernel/uapi/uapi_prof.h>
+
+#include <stdint.h>
+
+#define PROF_MAX_SAMPLES 8192 // Sampling stops when the buffer is full
+
+uint32_t prof_start(uint32_t freq);
+uint32_t prof_stop();
+uint32_t prof_read(prof_sample_t* buf, uint32_t count, uint32_t offset);
+void prof_dump();
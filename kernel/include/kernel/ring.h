@@ -0,0 +1,6 @@
+#pragma once
+
+#include <kernel/uapi/uapi_ring.h>
+
+int32_t ring_setup(ring_t* ring);
+int32_t ring_enter();
@@ -0,0 +1,5 @@
+#pragma once
+
+#include <kernel/proc.h>
+
+sched_t* sched_mlfq();
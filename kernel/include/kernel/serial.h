@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdint.h>
+
 #define SERIAL_PORT 0x3F8
 
 #define SERIAL_DR 0
@@ -14,4 +16,5 @@
 void init_serial();
 char serial_read();
 void serial_write(char c);
+void serial_write_raw(const uint8_t* buf, uint32_t size);
 char* serial_get_log();
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CPU_MAX 8
+
+#define SMP_TRAMPOLINE 0x8000 // Page-aligned and below 1 MiB, see `ap_boot.S`
+#define SMP_STACK_SIZE 0x2000
+#define SMP_START_TIMEOUT 100 // In milliseconds
+#define SMP_NO_CPU 0xFFFFFFFF
+
+typedef struct {
+    uint32_t id; // Index in the CPU list, 0 for the boot processor
+    uint32_t lapic_id;
+    volatile bool online;
+    uintptr_t kernel_stack;
+} cpu_t;
+
+void init_smp();
+uint32_t smp_cpu_count();
+uint32_t smp_current_cpu();
+void smp_kernel_lock();
+void smp_kernel_unlock();
+uint32_t smp_kernel_lock_depth();
+void smp_kernel_lock_set_depth(uint32_t depth);
+void smp_send_resched(uint32_t cpu);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <kernel/irq.h>
+
+#include <stdint.h>
+
+/* A lock for state shared between CPUs. Interrupts are disabled on the CPU
+ * holding it, so that an interrupt handler can't try to take it again.
+ * Initialize with `SPINLOCK_INIT`.
+ */
+typedef struct {
+    volatile uint32_t locked;
+    uint32_t eflags; // Of the holder, before it took the lock
+} spinlock_t;
+
+#define SPINLOCK_INIT ((spinlock_t) { .locked = 0, .eflags = 0 })
+
+static inline void spinlock_acquire(spinlock_t* lock) {
+    uint32_t eflags = irq_save();
+
+    while (__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE)) {
+        asm volatile ("pause");
+    }
+
+    lock->eflags = eflags;
+}
+
+static inline void spinlock_release(spinlock_t* lock) {
+    uint32_t eflags = lock->eflags;
+
+    __atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
+    irq_restore(eflags);
+}
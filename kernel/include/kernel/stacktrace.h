@@ -2,5 +2,6 @@
 
 #include <stdint.h>
 
-void init_stacktrace(uint8_t* data, uint32_t size);
+void init_stacktrace(const uint8_t* data, uint32_t size);
+uintptr_t stacktrace_lookup(uintptr_t addr, char* buf, uint32_t size);
 void stacktrace_print();
\ No newline at end of file
@@ -2,9 +2,13 @@
 
 #include <kernel/isr.h>
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #define SYSCALL_NUM 64
 
 void init_syscall();
-void syscall_register_handler(uint32_t num, handler_t handler);
\ No newline at end of file
+void syscall_init_ap();
+void syscall_handler(registers_t* regs);
+void syscall_register_handler(uint32_t num, handler_t handler);
+bool syscall_has_sysenter();
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <kernel/isr.h>
+#include <kernel/proc.h>
+
+#include <kernel/uapi/uapi_systrace.h>
+
+#define SYSTRACE_BUF_SIZE 512 // Records kept in the trace buffer
+
+/* State of a system call being accounted, see `systrace_begin`.
+ */
+typedef struct {
+    process_t* proc;
+    uint32_t syscall;
+    uint32_t args[4];
+    uint64_t start;
+} systrace_call_t;
+
+void init_systrace();
+void systrace_begin(systrace_call_t* call, const registers_t* regs);
+void systrace_end(const systrace_call_t* call, int32_t ret);
+void systrace_follow(bool follow);
+int32_t systrace_stats(systrace_stats_t* stats, uint32_t pid);
+uint32_t systrace_read(systrace_record_t* buf, uint32_t count, uint32_t* cursor);
@@ -3,17 +3,35 @@
 #include <kernel/irq.h>
 
 void init_timer();
+void timer_init_smp();
+void timer_init_ap();
 void timer_callback();
 uint32_t timer_get_tick();
 float timer_get_time();
 void timer_register_callback(handler_t handler);
 void timer_remove_callback(handler_t handler);
+void timer_set_next_tick(uint32_t delay);
+void timer_use_clock();
+void timer_pit_wait(uint32_t ms);
+uint32_t timer_start_sampling(handler_t handler, uint32_t freq);
+void timer_stop_sampling();
 
 #define TIMER_FREQ 50 // in Hz
+#define TIMER_NS_PER_TICK (1000000000 / TIMER_FREQ)
 #define TIMER_QUOTIENT 1193180
+#define TIMER_CALIBRATION_MS 10
+#define TIMER_SAMPLING_MIN 20 // in Hz
+#define TIMER_SAMPLING_MAX 10000
 
 #define PIT_0 0x40
 #define PIT_1 0x41
 #define PIT_2 0x42
 #define PIT_CMD 0x43
-#define PIT_SET 0x36
\ No newline at end of file
+#define PIT_SET 0x36
+#define PIT_SET_CH2_ONESHOT 0xB0
+
+// Keyboard controller port controlling PIT channel 2
+#define PIT_PORT_B 0x61
+#define PIT_PORT_B_GATE2   0x01
+#define PIT_PORT_B_SPEAKER 0x02
+#define PIT_PORT_B_OUT2    0x20
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <kernel/uapi/uapi_trace.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TRACE_BUF_SIZE 8192 // Records kept, must be a power of two
+
+extern bool trace_enabled;
+
+void trace_record(uint32_t event, uint32_t arg0, uint32_t arg1);
+void trace_start();
+uint32_t trace_stop();
+void trace_dump();
+
+/* Records an event if tracing is enabled; cheap enough to call from hot paths
+ * when it isn't.
+ */
+static inline void trace_event(uint32_t event, uint32_t arg0, uint32_t arg1) {
+    if (trace_enabled) {
+        trace_record(event, arg0, arg1);
+    }
+}
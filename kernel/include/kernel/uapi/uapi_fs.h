@@ -24,6 +24,8 @@
 
 #define FS_STDOUT_FILENO 1
 
+#define FS_IOV_MAX 1024 // Maximum number of buffers in a vectored read or write
+
 typedef struct {
     uint32_t inode;
     uint16_t entry_size;
@@ -38,4 +40,12 @@ typedef struct stat_t {
     uint32_t st_mode;
     uint32_t st_nlink;
     uint32_t st_size;
-} stat_t;
\ No newline at end of file
+} stat_t;
+
+/* A buffer for `SYS_READV` and `SYS_WRITEV`, which process arrays of them in
+ * order.
+ */
+typedef struct iovec {
+    void* iov_base;
+    uint32_t iov_len;
+} iovec_t;
\ No newline at end of file
@@ -0,0 +1,9 @@
+#pragma once
+
+// Commands for `SYS_FUTEX`
+#define FUTEX_CMD_WAIT 1 // Blocks if *%ecx == %edx, for at most %esi ms if not 0
+#define FUTEX_CMD_WAKE 2 // Wakes up at most %edx threads blocked on %ecx
+
+// Results of `FUTEX_CMD_WAIT` other than 0, returned when woken up
+#define FUTEX_AGAIN -1 // The value differed, or the address is invalid
+#define FUTEX_TIMEDOUT -2
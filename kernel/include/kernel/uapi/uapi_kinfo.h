@@ -0,0 +1,40 @@
+#pragma once
+
+/* Address at which the kernel info page is mapped, read-only, in every
+ * process.
+ */
+#define KINFO_ADDR 0xFFBFF000
+
+// Offset of `kinfo_t.sysenter`, for use in assembly
+#define KINFO_SYSENTER 4
+
+#ifndef __ASSEMBLER__
+
+#include <stdint.h>
+
+#include <kernel/uapi/uapi_wm.h>
+
+/* Information the kernel shares with every process through a read-only page,
+ * so that reading it doesn't require a system call.
+ * The kernel makes `seq` odd while it updates the page: readers must retry
+ * if `seq` is odd, or if it changed while they were reading.
+ * Monotonic time in nanoseconds is computed from the TSC as
+ *   ((rdtsc() - tsc_base) * ns_per_cycle) >> 32
+ * when `tsc_valid` is set, see `clock.c`.
+ */
+typedef struct {
+    uint32_t seq;
+    uint32_t sysenter; // Whether system calls may use `sysenter`
+    uint32_t tsc_valid;
+    uint64_t tsc_base;
+    uint64_t ns_per_cycle;
+    uint32_t ticks; // Tick count at the last update
+    uint32_t timer_freq;
+    uint32_t kernel_heap_usage;
+    uint32_t ram_usage;
+    uint32_t ram_total;
+    uint32_t cpu_usage; // In percent, over the last second
+    fb_t fb;
+} kinfo_t;
+
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+#define PROCSTAT_NAME_MAX 16
+
+// Values of `procstat_t.state`
+#define PROCSTAT_RUNNABLE 'R'
+#define PROCSTAT_SLEEPING 'S'
+#define PROCSTAT_BLOCKED  'B'
+#define PROCSTAT_ZOMBIE   'Z'
+
+/* Accounting information about a thread, filled by `SYS_PROCSTAT`.
+ * Times are in TSC cycles, convertible to nanoseconds with the kernel info
+ * page's `ns_per_cycle`. They're zero if the CPU lacks a TSC.
+ * Memory sizes are those of the whole process.
+ */
+typedef struct {
+    uint32_t pid; // Thread id, equal to `tgid` for main threads
+    uint32_t tgid; // Pid of the main thread of the process
+    uint32_t parent_pid;
+    uint32_t state;
+    char name[PROCSTAT_NAME_MAX];
+    uint64_t user_cycles;
+    uint64_t kernel_cycles; // Includes interrupts that happened while running
+    uint32_t voluntary_switches; // Switched away from when blocking or exiting
+    uint32_t involuntary_switches; // Preempted or yielded while runnable
+    uint32_t page_faults;
+    uint32_t syscalls;
+    uint32_t rss; // In bytes
+    uint32_t peak_rss;
+} procstat_t;
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+// Commands for `SYS_PROF`
+#define PROF_CMD_START 1 // Starts sampling at about %ecx Hz, 0 for the default
+#define PROF_CMD_STOP 2 // Returns the number of samples taken
+#define PROF_CMD_READ 3 // Copies at most %edx samples to %ecx, from index %esi
+#define PROF_CMD_DUMP 4 // Prints the samples to the serial port
+#define PROF_CMD_SYMBOL 5 // Names the kernel symbol at %ecx in %edx, of size %esi
+
+#define PROF_DEFAULT_FREQ 1000
+
+#define PROF_SAMPLE_USER 1 // The sample interrupted userspace
+
+/* Where a thread was when the profiling interrupt hit.
+ */
+typedef struct {
+    uint32_t eip;
+    uint32_t pid; // Thread id, 0 for the idle task
+    uint32_t flags;
+} prof_sample_t;
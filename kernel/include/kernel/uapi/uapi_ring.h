@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+
+#define RING_SIZE 64 // Entries in each ring, must be a power of two
+
+// Commands for `SYS_RING`
+#define RING_CMD_SETUP 1 // Registers the ring passed in %ecx, NULL to unregister
+#define RING_CMD_ENTER 2 // Processes pending submissions
+
+/* A system call to run asynchronously. Only system calls that don't block or
+ * change the process are accepted: reads, writes, `open`, `close`, `stat`,
+ * seeking and rendering windows with `WM_CMD_RENDER`. Pointers passed as
+ * arguments must stay valid until the completion is received.
+ */
+typedef struct {
+    uint32_t syscall; // A `SYS_*` number
+    uint32_t args[4]; // What would go in %ebx, %ecx, %edx and %esi
+    uint32_t user_data; // Copied to the completion
+} ring_sqe_t;
+
+typedef struct {
+    uint32_t user_data;
+    int32_t result; // The system call's return value, -1 if it was refused
+} ring_cqe_t;
+
+/* A pair of rings shared between a process and the kernel, which lets a
+ * process batch system calls: it queues them in `sq`, then a single
+ * `SYS_RING` call with `RING_CMD_ENTER` runs them all, their results being
+ * queued in `cq`.
+ * Heads and tails are free-running counters, indices in the arrays are taken
+ * modulo `RING_SIZE`. The process owns `sq_tail` and `cq_head`, the kernel
+ * owns the other two. The kernel stops consuming submissions when the
+ * completion ring is full.
+ */
+typedef struct {
+    uint32_t sq_head;
+    uint32_t sq_tail;
+    uint32_t cq_head;
+    uint32_t cq_tail;
+    ring_sqe_t sq[RING_SIZE];
+    ring_cqe_t cq[RING_SIZE];
+} ring_t;
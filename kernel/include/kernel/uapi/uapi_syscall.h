@@ -26,11 +26,46 @@
 #define SYS_RENAME 20
 #define SYS_MAKETTY 21
 #define SYS_STAT 22
-#define SYS_MAX 23 // First invalid syscall number
+#define SYS_CLOCK 23
+#define SYS_GETPID 24
+#define SYS_READV 25
+#define SYS_WRITEV 26
+#define SYS_PREAD 27
+#define SYS_PWRITE 28
+#define SYS_RING 29
+#define SYS_SYSTRACE 30
+#define SYS_WAITPID 31
+#define SYS_THREAD 32
+#define SYS_FUTEX 33
+#define SYS_PROCSTAT 34
+#define SYS_PROF 35
+#define SYS_TRACE 36
+#define SYS_MAX 37 // First invalid syscall number
 
 #define SYS_INFO_UPTIME 1
 #define SYS_INFO_MEMORY 2
 #define SYS_INFO_LOG    4
+#define SYS_INFO_CPU    8
+#define SYS_INFO_BOOT   16
+
+// Boot timeline returned by `SYS_INFO_BOOT`
+#define BOOT_PHASE_MAX 48
+#define BOOT_PHASE_NAME_MAX 24
+
+// Flags for `SYS_WAITPID`
+#define WAIT_NOHANG 1 // Don't block if the child hasn't exited yet
+
+// Clocks for `SYS_CLOCK`, in nanoseconds
+#define CLOCK_MONOTONIC 1 // Time since boot
+
+/* A step of the boot process, timed with the TSC. Times are in microseconds
+ * since the kernel was entered.
+ */
+typedef struct {
+    char name[BOOT_PHASE_NAME_MAX];
+    uint32_t start;
+    uint32_t duration;
+} boot_phase_t;
 
 typedef struct {
     uint32_t kernel_heap_usage;
@@ -38,6 +73,10 @@ typedef struct {
     uint32_t ram_total;
     float uptime;
     char* kernel_log; // Must be at least 2048 bytes long
+    uint32_t cpu_usage; // In percent, over the last second
+    float idle_time; // Time spent idle since boot, in seconds
+    boot_phase_t* boot_phases; // Must hold `BOOT_PHASE_MAX` phases
+    uint32_t boot_phase_count;
 } sys_info_t;
 
 typedef struct {
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <kernel/uapi/uapi_syscall.h>
+
+#include <stdint.h>
+
+// Commands for `SYS_SYSTRACE`
+#define SYSTRACE_CMD_STATS 1 // Fills the `systrace_stats_t*` in %ecx for pid %edx, 0 for all
+#define SYSTRACE_CMD_FOLLOW 2 // Traces processes we `exec` from now on if %ecx is set
+#define SYSTRACE_CMD_READ 3 // See `systrace_read`
+
+/* Bucket `i` of a latency histogram counts calls that took less than
+ * `2^(i + SYSTRACE_BUCKET_SHIFT)` cycles, and at least half of that. The first
+ * bucket counts everything faster, the last one everything slower.
+ */
+#define SYSTRACE_BUCKETS 20
+#define SYSTRACE_BUCKET_SHIFT 7
+
+/* Durations are in TSC cycles, convertible to nanoseconds with the kernel
+ * info page's `ns_per_cycle`. They're zero if the CPU lacks a TSC.
+ */
+typedef struct {
+    uint32_t count[SYS_MAX];
+    uint64_t cycles[SYS_MAX];
+    uint32_t histogram[SYS_MAX][SYSTRACE_BUCKETS]; // Only kept globally
+} systrace_stats_t;
+
+/* A system call made by a traced process.
+ */
+typedef struct {
+    uint32_t seq; // Position in the trace, consecutive unless records were lost
+    uint32_t pid;
+    uint32_t syscall;
+    uint32_t args[4]; // %ebx, %ecx, %edx and %esi
+    int32_t ret;
+    uint32_t cycles;
+} systrace_record_t;
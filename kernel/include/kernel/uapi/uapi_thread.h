@@ -0,0 +1,9 @@
+#pragma once
+
+// Commands for `SYS_THREAD`
+#define THREAD_CMD_CREATE 1 // Starts a thread at %ecx with stack %edx, TLS %esi
+#define THREAD_CMD_EXIT 2 // Exits the current thread with status %ecx
+#define THREAD_CMD_JOIN 3 // Waits for thread %ecx, stores its status in %edx
+#define THREAD_CMD_SELF 4 // Returns the current thread's id
+#define THREAD_CMD_SET_TLS 5 // Sets the current thread's TLS pointer to %ecx
+#define THREAD_CMD_GET_TLS 6 // Returns the current thread's TLS pointer
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+// Commands for `SYS_TRACE`
+#define TRACE_CMD_START 1 // Clears the trace buffer and starts recording
+#define TRACE_CMD_STOP 2 // Returns the number of records available
+#define TRACE_CMD_DUMP 3 // Stops recording, streams the records over serial
+
+/* Events, with the meaning of their two arguments.
+ * `misc/trace2json.py` decodes them, keep it in sync.
+ */
+#define TRACE_SWITCH 1 // Previous thread id, next thread id
+#define TRACE_IRQ_ENTRY 2 // Interrupt vector, thread id
+#define TRACE_IRQ_EXIT 3 // Interrupt vector, thread id
+#define TRACE_SYSCALL_ENTRY 4 // System call number, thread id
+#define TRACE_SYSCALL_EXIT 5 // System call number, return value
+#define TRACE_PAGE_FAULT 6 // Faulting address, faulting instruction
+#define TRACE_WM_RENDER_BEGIN 7 // Window id or 0 for the screen, area in pixels
+#define TRACE_WM_RENDER_END 8 // Window id or 0 for the screen, unused
+
+/* Serial dump format, all integers little-endian:
+ *     header: "SFTRACE" 0x02, u32 number of records, u32 records lost
+ *     records: u8 event, u8 cpu, then as unsigned LEB128 varints: time in ns
+ *              since the previous record (since boot for the first one) as a
+ *              zigzag-encoded signed delta, first argument, second argument
+ *     trailer: u8 0xFF
+ */
+#define TRACE_DUMP_MAGIC "SFTRACE\x02"
+#define TRACE_DUMP_END 0xFF
+
+typedef struct {
+    uint64_t time; // In nanoseconds since boot, see `clock_get_ns`
+    uint16_t event;
+    uint16_t cpu;
+    uint32_t args[2];
+} __attribute__ ((packed)) trace_record_t;
@@ -18,6 +18,7 @@ enum WM_CMD {
     WM_CMD_GET_POS,
     WM_CMD_IS_DRAGGED,
     WM_CMD_IS_HOVERED,
+    WM_CMD_WAIT_EVENT,
 };
 
 enum WM_EVENT {
@@ -84,4 +85,5 @@ typedef struct {
 typedef struct {
     uint32_t win_id;
     wm_event_t* event;
+    uint32_t timeout; // In ms for `WM_CMD_WAIT_EVENT`, 0 to wait forever
 } wm_param_event_t;
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <kernel/fb.h>
+#include <kernel/proc.h>
 
 #include <stdint.h>
 #include <stdbool.h>
@@ -23,6 +24,8 @@ typedef struct _wm_window_t {
     uint32_t id;
     uint32_t flags;
     ringbuffer_t* events;
+    uint32_t owner; // pid of the process that opened the window
+    wait_queue_t waiters; // Processes blocked in `wm_wait_event`
 } wm_window_t;
 
 // Rename this for convenience.
@@ -32,8 +35,10 @@ void init_wm();
 
 uint32_t wm_open_window(fb_t* fb, uint32_t flags);
 void wm_close_window(uint32_t win_id);
+void wm_close_windows_of(uint32_t pid);
 void wm_render_window(uint32_t win_id, rect_t* clip);
 void wm_get_event(uint32_t win_id, wm_event_t* event);
+void wm_wait_event(uint32_t win_id, wm_event_t* event, uint32_t timeout);
 
 bool wm_is_titlebar_being_hovered(wm_window_t* win);
 list_t* wm_get_window(uint32_t id);
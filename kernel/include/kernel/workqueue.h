@@ -0,0 +1,33 @@
+#pragma once
+
+#include <kernel/proc.h>
+
+#include <stdbool.h>
+
+typedef void (*work_fn_t)(void*);
+
+/* A piece of deferred work, usually embedded in whatever it works on, so that
+ * queuing it needs no memory of its own. Waking the queue's thread up does use
+ * the heap, which masks interrupts while in use, so queuing can be done from
+ * interrupt handlers. Initialize with `WORK_INIT`.
+ */
+typedef struct _work_t {
+    work_fn_t fn;
+    void* arg;
+    bool pending; // Whether it's queued already
+    struct _work_t* next;
+} work_t;
+
+#define WORK_INIT(func, data) ((work_t) { .fn = (func), .arg = (data) })
+
+/* Work items run in order by a kernel thread of their own.
+ */
+typedef struct {
+    work_t* head;
+    work_t* tail;
+    wait_queue_t idle; // Where the thread waits for work
+    process_t* thread;
+} workqueue_t;
+
+workqueue_t* workqueue_new();
+bool workqueue_push(workqueue_t* wq, work_t* work);
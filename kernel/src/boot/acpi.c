@@ -0,0 +1,131 @@
+#include <kernel/acpi.h>
+#include <kernel/paging.h>
+#include <kernel/sys.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Minimal access to the ACPI tables: we only look tables up by signature, to
+ * enumerate CPUs from the MADT for now.
+ * Tables can be anywhere in physical memory, so they're mapped in the kernel
+ * heap the same way the LAPIC is, see `init_lapic`. The physical pages
+ * initially backing those heap pages are lost, which is fine for the few
+ * tables we look at during boot.
+ */
+
+static acpi_sdt_header_t* root = NULL; // The RSDT or XSDT
+static bool extended = false; // Whether `root` is the XSDT, with 64 bits entries
+
+static uintptr_t window; // Two pages used to peek at table headers
+
+static void acpi_remap(uintptr_t virt, uintptr_t phys, uint32_t num) {
+    for (uint32_t i = 0; i < num; i++) {
+        page_t* p = paging_get_page(virt + i*0x1000, false, 0);
+        *p = (phys + i*0x1000) | PAGE_PRESENT | PAGE_RW;
+        paging_invalidate_page(virt + i*0x1000);
+    }
+}
+
+/* Maps the header of the table at `phys` in the peeking window, and returns
+ * it. A header can't span more than two pages.
+ */
+static acpi_sdt_header_t* acpi_peek_table(uintptr_t phys) {
+    acpi_remap(window, phys & PAGE_FRAME, 2);
+
+    return (acpi_sdt_header_t*) (window + (phys & PAGE_FLAGS));
+}
+
+/* Maps the whole table at `phys` for good, and returns it.
+ */
+static acpi_sdt_header_t* acpi_map_table(uintptr_t phys) {
+    uint32_t offset = phys & PAGE_FLAGS;
+    uint32_t length = acpi_peek_table(phys)->length;
+    uint32_t num = divide_up(offset + length, 0x1000);
+
+    uintptr_t virt = (uintptr_t) kamalloc(num*0x1000, 0x1000);
+    acpi_remap(virt, phys & PAGE_FRAME, num);
+
+    return (acpi_sdt_header_t*) (virt + offset);
+}
+
+/* Tables are valid if all their bytes sum to zero.
+ */
+static bool acpi_checksum(acpi_sdt_header_t* table) {
+    uint8_t* bytes = (uint8_t*) table;
+    uint8_t sum = 0;
+
+    for (uint32_t i = 0; i < table->length; i++) {
+        sum += bytes[i];
+    }
+
+    return sum == 0;
+}
+
+/* Finds the root table from the RSDP given to us by GRUB, preferring the XSDT
+ * when there's one we can reach.
+ */
+void init_acpi(mb2_t* boot) {
+    mb2_tag_rsdp1_t* tag1 = (mb2_tag_rsdp1_t*) mb2_find_tag(boot, MB2_TAG_RSDP1);
+    mb2_tag_rsdp2_t* tag2 = (mb2_tag_rsdp2_t*) mb2_find_tag(boot, MB2_TAG_RSDP2);
+    uintptr_t phys;
+
+    if (tag2 && tag2->rsdp.xsdt_addr && tag2->rsdp.xsdt_addr <= 0xFFFFFFFF) {
+        phys = (uintptr_t) tag2->rsdp.xsdt_addr;
+        extended = true;
+    } else if (tag2) {
+        phys = tag2->rsdp.rsdp1.rsdt_addr;
+    } else if (tag1) {
+        phys = tag1->rsdp.rsdt_addr;
+    } else {
+        printk("no ACPI tables found");
+        return;
+    }
+
+    window = (uintptr_t) kamalloc(2*0x1000, 0x1000);
+    root = acpi_map_table(phys);
+
+    if (!acpi_checksum(root)) {
+        printke("invalid ACPI %s checksum", extended ? "XSDT" : "RSDT");
+        root = NULL;
+        return;
+    }
+
+    printk("found the ACPI %s at 0x%X", extended ? "XSDT" : "RSDT", phys);
+}
+
+/* Returns the first valid table with the given four-letter signature, NULL if
+ * there's none.
+ */
+acpi_sdt_header_t* acpi_find_table(const char* signature) {
+    if (!root) {
+        return NULL;
+    }
+
+    uint32_t entry_size = extended ? 8 : 4;
+    uint32_t count = (root->length - sizeof(acpi_sdt_header_t)) / entry_size;
+    uint8_t* entries = (uint8_t*) root + sizeof(acpi_sdt_header_t);
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t phys = extended ?
+            *(uint64_t*) &entries[i*8] : *(uint32_t*) &entries[i*4];
+
+        if (phys > 0xFFFFFFFF) {
+            continue;
+        }
+
+        if (strncmp(acpi_peek_table(phys)->signature, signature, 4)) {
+            continue;
+        }
+
+        acpi_sdt_header_t* table = acpi_map_table(phys);
+
+        if (acpi_checksum(table)) {
+            return table;
+        }
+
+        printke("invalid ACPI %s checksum", signature);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,68 @@
+#include <kernel/cmdline.h>
+#include <kernel/sys.h>
+
+#include <string.h>
+
+/* The kernel command line is a list of space-separated options of the form
+ * `key` or `key=value`, given by the bootloader after the kernel's path, e.g.
+ *     multiboot2 /boot/SnowflakeOS.kernel sched=mlfq
+ */
+static char cmdline[CMDLINE_MAX];
+
+void init_cmdline(mb2_t* boot) {
+    mb2_tag_cmdline_t* tag = (mb2_tag_cmdline_t*) mb2_find_tag(boot, MB2_TAG_CMDLINE);
+
+    if (!tag) {
+        return;
+    }
+
+    strncpy(cmdline, (char*) tag->cmdline, CMDLINE_MAX - 1);
+    cmdline[CMDLINE_MAX - 1] = '\0';
+
+    if (cmdline[0]) {
+        printk("command line: %s", cmdline);
+    }
+}
+
+/* Returns a pointer to the first option named `key` on the command line, NULL
+ * if there's none.
+ */
+static const char* cmdline_find(const char* key) {
+    uint32_t key_len = strlen(key);
+    const char* opt = cmdline;
+
+    while (*opt) {
+        while (*opt == ' ') {
+            opt++;
+        }
+
+        if (!strncmp(opt, key, key_len) &&
+                (opt[key_len] == '=' || opt[key_len] == ' ' || !opt[key_len])) {
+            return opt;
+        }
+
+        opt = strchrnul(opt, ' ');
+    }
+
+    return NULL;
+}
+
+/* Returns the value of the option `key=value`, NULL if it wasn't given.
+ * The returned string is statically allocated.
+ */
+const char* cmdline_get(const char* key) {
+    static char value[CMDLINE_MAX];
+    const char* opt = cmdline_find(key);
+
+    if (!opt || opt[strlen(key)] != '=') {
+        return NULL;
+    }
+
+    opt += strlen(key) + 1;
+    uint32_t len = strchrnul(opt, ' ') - opt;
+
+    strncpy(value, opt, len);
+    value[len] = '\0';
+
+    return value;
+}
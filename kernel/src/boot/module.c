@@ -0,0 +1,70 @@
+#include <kernel/module.h>
+#include <kernel/cmdline.h>
+#include <kernel/paging.h>
+#include <kernel/sys.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* GRUB modules are used where GRUB loaded them: their physical pages, which
+ * `init_pmm` keeps out of the allocator, are mapped in a region of kernel space
+ * reserved for them. Mappings are made before the first process is created,
+ * so every process shares them.
+ * With `modules=release` on the command line, modules whose content isn't
+ * needed after boot give their pages back to the allocator.
+ */
+
+static uintptr_t next_virt = KERNEL_MODULES_BEGIN;
+
+/* Maps `mod` in kernel space and returns its address, NULL if it doesn't fit
+ * in the modules region.
+ */
+void* module_map(mb2_tag_module_t* mod) {
+    uintptr_t phys = mod->mod_start & PAGE_FRAME;
+    uint32_t offset = mod->mod_start & PAGE_FLAGS;
+    uint32_t num = divide_up(mod->mod_end - phys, 0x1000);
+
+    if (next_virt + num*0x1000 > KERNEL_MODULES_BEGIN + KERNEL_MODULES_SIZE) {
+        printke("no room to map module %s", mod->name);
+        return NULL;
+    }
+
+    uintptr_t virt = next_virt;
+
+    paging_map_pages(virt, phys, num, PAGE_RW);
+    next_virt += num*0x1000;
+
+    return (void*) (virt + offset);
+}
+
+/* Unmaps `mod`, mapped at `data`, and frees the pages it doesn't share with
+ * its neighbors in physical memory.
+ */
+void module_release(mb2_tag_module_t* mod, void* data) {
+    uintptr_t virt = (uintptr_t) data & PAGE_FRAME;
+    uintptr_t phys = mod->mod_start & PAGE_FRAME;
+    uint32_t num = divide_up(mod->mod_end - phys, 0x1000);
+    uint32_t freed = 0;
+
+    for (uint32_t i = 0; i < num; i++) {
+        uintptr_t page = phys + i*0x1000;
+
+        if (page >= mod->mod_start && page + 0x1000 <= mod->mod_end) {
+            paging_unmap_page(virt + i*0x1000);
+            freed++;
+        } else {
+            *paging_get_page(virt + i*0x1000, false, 0) = 0;
+        }
+
+        paging_invalidate_page(virt + i*0x1000);
+    }
+
+    printk("released module %s, %d KiB", mod->name, freed*4);
+}
+
+bool module_release_enabled() {
+    const char* modules = cmdline_get("modules");
+
+    return modules && !strcmp(modules, "release");
+}
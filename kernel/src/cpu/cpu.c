@@ -0,0 +1,41 @@
+#include <kernel/cpu.h>
+
+/* Wrappers around CPU identification and model-specific registers.
+ */
+
+cpuid_t cpu_cpuid(uint32_t leaf) {
+    cpuid_t r;
+
+    asm volatile ("cpuid"
+        : "=a" (r.eax), "=b" (r.ebx), "=c" (r.ecx), "=d" (r.edx)
+        : "a" (leaf), "c" (0));
+
+    return r;
+}
+
+/* Returns whether the feature bit `feature` is set in %edx for CPUID leaf 1.
+ */
+bool cpu_has_feature_edx(uint32_t feature) {
+    return cpu_cpuid(1).edx & feature;
+}
+
+uint64_t cpu_rdmsr(uint32_t msr) {
+    uint32_t low, high;
+
+    asm volatile ("rdmsr" : "=a" (low), "=d" (high) : "c" (msr));
+
+    return ((uint64_t) high << 32) | low;
+}
+
+void cpu_wrmsr(uint32_t msr, uint64_t value) {
+    asm volatile ("wrmsr"
+        :: "c" (msr), "a" ((uint32_t) value), "d" ((uint32_t) (value >> 32)));
+}
+
+uint64_t cpu_rdtsc() {
+    uint32_t low, high;
+
+    asm volatile ("rdtsc" : "=a" (low), "=d" (high));
+
+    return ((uint64_t) high << 32) | low;
+}
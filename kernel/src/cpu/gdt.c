@@ -3,13 +3,18 @@
 
 #include <kernel/gdt.h>
 #include <kernel/idt.h>
+#include <kernel/cpu.h>
+#include <kernel/smp.h>
+#include <kernel/syscall.h>
 
-static gdt_entry_t gdt_entries[6];
+// Segments are shared, but each CPU has its own TSS after them
+static gdt_entry_t gdt_entries[GDT_TSS_BASE + CPU_MAX];
 static gdt_pointer_t gdt_ptr;
 
-static tss_entry_t tss;
+static tss_entry_t tss[CPU_MAX];
 
-/* Loads up and fills the GDT with all the entries we need.
+/* Loads up and fills the GDT with all the entries we need, and loads the
+ * boot processor's TSS.
  */
 void init_gdt() {
     gdt_ptr.offset = (uint32_t) &gdt_entries;
@@ -21,13 +26,21 @@ void init_gdt() {
     gdt_set_entry(3, 0, 0xFFFFFFFF, GDT_ACCESS_USER_CODE, GDT_FLAGS);
     gdt_set_entry(4, 0, 0xFFFFFFFF, GDT_ACCESS_USER_DATA, GDT_FLAGS);
 
-    gdt_write_tss(5, 0x10, 0x00);
+    gdt_init_cpu(0, 0x00);
+}
+
+/* Loads the GDT on the calling CPU, along with the TSS of CPU number `cpu`,
+ * whose kernel stack is set to `stack`.
+ */
+void gdt_init_cpu(uint32_t cpu, uintptr_t stack) {
+    uint32_t num = GDT_TSS_BASE + cpu;
 
+    gdt_write_tss(num, 0x10, stack);
     gdt_load(&gdt_ptr);
 
-    // 0x2B = 0+5*8bytes | 3 (bottom 2 bits control ring number)
-    asm("mov $0x2B, %ax\n" // Flush the TSS
-        "ltr %ax\n");
+    // e.g. 0x2B = 0+5*8bytes | 3 (bottom 2 bits control ring number)
+    uint16_t selector = num*8 | 3;
+    asm volatile ("ltr %0\n" :: "r" (selector)); // Flush the TSS
 }
 
 /* See `gdt.h` for some "explanation" of the parameters here.
@@ -46,26 +59,32 @@ void gdt_set_entry(uint32_t num, uint32_t base, uint32_t limit, uint8_t access,
     gdt_entries[num].access = access;
 }
 
-/* Writes the GDT entry corresponding to a barebones TSS with a specific
+/* Writes the GDT entry `num` corresponding to a barebones TSS with a specific
  * data segment selector `ss0` and stack pointer `esp0`.
  * Shamelessly taken from ToaruOS :)
  */
 void gdt_write_tss(uint32_t num, uint32_t ss0, uint32_t esp0) {
-    uintptr_t base = (uintptr_t) &tss;
-    uintptr_t limit = base + sizeof(tss);
+    tss_entry_t* entry = &tss[num - GDT_TSS_BASE];
+    uintptr_t base = (uintptr_t) entry;
+    uintptr_t limit = base + sizeof(tss_entry_t);
 
     /* Add the TSS descriptor to the GDT */
     gdt_set_entry(num, base, limit, 0xE9, 0x00);
 
-    memset(&tss, 0x00, sizeof(tss));
+    memset(entry, 0x00, sizeof(tss_entry_t));
 
-    tss.ss0 = ss0;
-    tss.esp0 = esp0;
-    tss.iomap_base = sizeof(tss);
+    entry->ss0 = ss0;
+    entry->esp0 = esp0;
+    entry->iomap_base = sizeof(tss_entry_t);
 }
 
-/* Sets the stack pointer that will be used when the next interrupt happens.
+/* Sets the stack pointer that will be used when the next interrupt or
+ * `sysenter` happens on the calling CPU.
  */
 void gdt_set_kernel_stack(uintptr_t stack) {
-    tss.esp0 = stack;
+    tss[smp_current_cpu()].esp0 = stack;
+
+    if (syscall_has_sysenter()) {
+        cpu_wrmsr(MSR_SYSENTER_ESP, stack);
+    }
 }
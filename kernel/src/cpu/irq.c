@@ -2,7 +2,10 @@
 #include <kernel/fpu.h>
 #include <kernel/idt.h>
 #include <kernel/irq.h>
+#include <kernel/proc.h>
+#include <kernel/smp.h>
 #include <kernel/sys.h>
+#include <kernel/trace.h>
 
 #include <string.h>
 
@@ -54,6 +57,9 @@ void init_irq() {
 void irq_handler(registers_t* regs) {
     uint32_t irq = regs->int_no;
 
+    smp_kernel_lock();
+    proc_account_entry(regs);
+    trace_event(TRACE_IRQ_ENTRY, irq, proc_get_current_tid());
     fpu_kernel_enter();
 
     // Handle spurious interrupts
@@ -68,6 +74,7 @@ void irq_handler(registers_t* regs) {
                 irq_send_eoi(IRQ0); // Sort of hackish
             }
 
+            smp_kernel_unlock();
             return;
         }
     }
@@ -82,7 +89,11 @@ void irq_handler(registers_t* regs) {
         printke("unhandled IRQ%d", irq - IRQ0);
     }
 
-    fpu_kernel_exit();
+    proc_preempt(regs);
+    trace_event(TRACE_IRQ_EXIT, irq, proc_get_current_tid());
+    proc_account_exit(regs);
+    fpu_kernel_exit(regs);
+    smp_kernel_unlock();
 }
 
 void irq_send_eoi(uint8_t irq) {
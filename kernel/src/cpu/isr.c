@@ -1,7 +1,10 @@
 #include <kernel/fpu.h>
 #include <kernel/idt.h>
 #include <kernel/isr.h>
+#include <kernel/proc.h>
+#include <kernel/smp.h>
 #include <kernel/sys.h>
+#include <kernel/trace.h>
 
 #include <assert.h>
 #include <stdlib.h>
@@ -87,6 +90,12 @@ void init_isr() {
 
     // Syscall interrupt gate
     idt_set_entry(48, (uint32_t) isr48, 0x08, IDT_INT_USER);
+
+    // Local APIC interrupts, see `lapic.c`
+    idt_set_entry(64, (uint32_t) isr64, 0x08, IDT_INT_KERNEL);
+    idt_set_entry(65, (uint32_t) isr65, 0x08, IDT_INT_KERNEL);
+    idt_set_entry(66, (uint32_t) isr66, 0x08, IDT_INT_KERNEL);
+    idt_set_entry(255, (uint32_t) isr255, 0x08, IDT_INT_KERNEL);
 }
 
 /* Calls the handler registered to a specific interrupt, if any.
@@ -96,8 +105,18 @@ void init_isr() {
 void isr_handler(registers_t* regs) {
     assert(regs->int_no < 256);
 
+    // LAPIC interrupts, as opposed to exceptions and system calls
+    bool irq = regs->int_no >= 32 && regs->int_no != 48;
+    uint32_t int_no = regs->int_no;
+
+    smp_kernel_lock();
+    proc_account_entry(regs);
     fpu_kernel_enter();
 
+    if (irq) {
+        trace_event(TRACE_IRQ_ENTRY, int_no, proc_get_current_tid());
+    }
+
     if (isr_handlers[regs->int_no]) {
         handler_t handler = isr_handlers[regs->int_no];
         handler(regs);
@@ -109,7 +128,13 @@ void isr_handler(registers_t* regs) {
         abort();
     }
 
-    fpu_kernel_exit();
+    if (irq) {
+        trace_event(TRACE_IRQ_EXIT, int_no, proc_get_current_tid());
+    }
+
+    proc_account_exit(regs);
+    fpu_kernel_exit(regs);
+    smp_kernel_unlock();
 }
 
 /* Registers a handler to be called when interrupt `num` fires.
@@ -0,0 +1,254 @@
+#include <kernel/smp.h>
+#include <kernel/acpi.h>
+#include <kernel/cmdline.h>
+#include <kernel/fpu.h>
+#include <kernel/gdt.h>
+#include <kernel/idt.h>
+#include <kernel/isr.h>
+#include <kernel/lapic.h>
+#include <kernel/paging.h>
+#include <kernel/proc.h>
+#include <kernel/syscall.h>
+#include <kernel/timer.h>
+#include <kernel/sys.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Starts the application processors listed in the ACPI MADT. Each one sets up
+ * its own TSS, LAPIC, LAPIC timer, FPU and `sysenter` registers, then runs
+ * processes from its own run queue, see `proc_init_ap`. External interrupts
+ * still only reach the boot processor.
+ *
+ * The rest of the kernel was written for a single CPU, and relies on nothing
+ * else running while it works: process lists, the VFS, the WM and drivers
+ * have no locks of their own. So only one CPU at a time runs kernel code,
+ * under the kernel lock, while userspace runs on all of them. The lock is
+ * taken when entering the kernel from an interrupt, exception or system call,
+ * and released when returning to userspace. Kernel threads run with
+ * interrupts enabled, so the CPU holding the lock may take it again.
+ * Switching processes keeps the lock: the next process releases it when it
+ * leaves the kernel, each process keeping track of how many times it took it,
+ * see `proc_schedule`. The idle loop releases it while halting.
+ */
+
+static volatile uint32_t lock_owner = SMP_NO_CPU; // CPU holding the kernel lock
+static uint32_t lock_depth = 0;
+
+extern uint8_t ap_boot_start[];
+extern uint8_t ap_boot_end[];
+extern uint32_t ap_boot_cr3;
+extern uint32_t ap_boot_stack;
+extern uint32_t ap_boot_entry;
+
+// Location of a trampoline parameter in its copy
+#define TRAMPOLINE_PARAM(param) \
+    ((uint32_t*) (SMP_TRAMPOLINE + ((uintptr_t) &param - (uintptr_t) ap_boot_start)))
+
+static cpu_t cpus[CPU_MAX];
+static uint32_t cpu_count = 1;
+
+static volatile uint32_t starting; // Index of the CPU being started
+
+static void smp_start_ap(uint32_t lapic_id);
+static void smp_ap_main();
+
+static void smp_resched_handler(registers_t* regs) {
+    lapic_eoi();
+    proc_resched(regs);
+}
+
+/* Starts the other processors unless `smp=off` is passed on the command line.
+ * Needs the LAPIC and the PIT, see `init_timer`. The caller must hold the
+ * kernel lock, which application processors wait for before running anything.
+ */
+void init_smp() {
+    cpus[0] = (cpu_t) {
+        .id = 0,
+        .online = true
+    };
+
+    const char* smp = cmdline_get("smp");
+
+    if (smp && !strcmp(smp, "off")) {
+        return;
+    }
+
+    acpi_madt_t* madt = (acpi_madt_t*) acpi_find_table(ACPI_SIG_MADT);
+
+    if (!madt || !init_lapic()) {
+        return;
+    }
+
+    cpus[0].lapic_id = lapic_id();
+
+    isr_register_handler(LAPIC_RESCHED_VECTOR, &smp_resched_handler);
+    timer_init_smp();
+
+    memcpy((void*) SMP_TRAMPOLINE, ap_boot_start, ap_boot_end - ap_boot_start);
+    *TRAMPOLINE_PARAM(ap_boot_cr3) = paging_get_kernel_directory();
+    *TRAMPOLINE_PARAM(ap_boot_entry) = (uintptr_t) &smp_ap_main;
+
+    uintptr_t entry = (uintptr_t) madt->entries;
+    uintptr_t end = (uintptr_t) madt + madt->header.length;
+
+    while (entry < end) {
+        acpi_madt_entry_t* header = (acpi_madt_entry_t*) entry;
+
+        if (header->type == MADT_TYPE_LAPIC) {
+            acpi_madt_lapic_t* lapic = (acpi_madt_lapic_t*) header;
+
+            if ((lapic->flags & MADT_LAPIC_ENABLED) &&
+                    lapic->lapic_id != cpus[0].lapic_id) {
+                smp_start_ap(lapic->lapic_id);
+            }
+        }
+
+        if (!header->length) {
+            break;
+        }
+
+        entry += header->length;
+    }
+
+    printk("%d CPU(s) online", cpu_count);
+}
+
+uint32_t smp_cpu_count() {
+    return cpu_count;
+}
+
+/* Returns the index of the calling CPU, 0 for the boot processor.
+ * Each CPU loads its own TSS, see `gdt_init_cpu`, so the task register tells
+ * them apart. Before the GDT is set up, it holds whatever the bootloader left.
+ */
+uint32_t smp_current_cpu() {
+    uint16_t selector;
+
+    asm volatile ("str %0" : "=r" (selector));
+
+    if (selector < GDT_TSS_BASE*8 || selector >= (GDT_TSS_BASE + CPU_MAX)*8) {
+        return 0;
+    }
+
+    return (selector >> 3) - GDT_TSS_BASE;
+}
+
+/* Takes the kernel lock, or takes it once more if the calling CPU holds it
+ * already. Must be called with interrupts disabled.
+ */
+void smp_kernel_lock() {
+    uint32_t cpu = smp_current_cpu();
+    uint32_t free = SMP_NO_CPU;
+
+    if (lock_owner == cpu) {
+        lock_depth++;
+        return;
+    }
+
+    while (!__atomic_compare_exchange_n(&lock_owner, &free, cpu, false,
+            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        free = SMP_NO_CPU;
+        asm volatile ("pause");
+    }
+
+    lock_depth = 1;
+}
+
+/* Releases the kernel lock once for each time it was taken.
+ */
+void smp_kernel_unlock() {
+    if (--lock_depth == 0) {
+        __atomic_store_n(&lock_owner, SMP_NO_CPU, __ATOMIC_RELEASE);
+    }
+}
+
+/* Returns how many times the calling CPU took the kernel lock, which it holds.
+ */
+uint32_t smp_kernel_lock_depth() {
+    return lock_depth;
+}
+
+/* Makes the calling CPU, which holds the kernel lock, hold it `depth` times,
+ * e.g. when switching to a process that took it a different number of times.
+ */
+void smp_kernel_lock_set_depth(uint32_t depth) {
+    lock_depth = depth;
+}
+
+/* Makes the CPU `cpu` run its scheduler as soon as it can, e.g. because a
+ * process it runs was woken up.
+ */
+void smp_send_resched(uint32_t cpu) {
+    lapic_send_ipi(cpus[cpu].lapic_id, LAPIC_ICR_ASSERT | LAPIC_RESCHED_VECTOR);
+}
+
+/* Starts a processor with the INIT-SIPI-SIPI sequence, giving it its own
+ * kernel stack, and waits until it reports as online.
+ */
+static void smp_start_ap(uint32_t lapic_id) {
+    if (cpu_count == CPU_MAX) {
+        printke("too many CPUs, ignoring LAPIC %d", lapic_id);
+        return;
+    }
+
+    cpu_t* cpu = &cpus[cpu_count];
+    uintptr_t stack = (uintptr_t) kmalloc(SMP_STACK_SIZE);
+
+    *cpu = (cpu_t) {
+        .id = cpu_count,
+        .lapic_id = lapic_id,
+        .online = false,
+        .kernel_stack = stack + SMP_STACK_SIZE
+    };
+
+    starting = cpu->id;
+    *TRAMPOLINE_PARAM(ap_boot_stack) = cpu->kernel_stack;
+
+    // The start-up vector is the page number of the trampoline
+    uint32_t startup = LAPIC_ICR_STARTUP | (SMP_TRAMPOLINE >> 12);
+
+    lapic_send_ipi(lapic_id, LAPIC_ICR_INIT | LAPIC_ICR_ASSERT);
+    timer_pit_wait(10);
+    lapic_send_ipi(lapic_id, startup);
+    timer_pit_wait(1);
+
+    // The second one is ignored if the first one worked
+    if (!cpu->online) {
+        lapic_send_ipi(lapic_id, startup);
+    }
+
+    for (uint32_t ms = 0; ms < SMP_START_TIMEOUT && !cpu->online; ms++) {
+        timer_pit_wait(1);
+    }
+
+    if (!cpu->online) {
+        printke("CPU with LAPIC %d didn't start", lapic_id);
+        kfree((void*) stack);
+        return;
+    }
+
+    cpu_count++;
+}
+
+/* Entry point of application processors, called by the trampoline in
+ * protected mode with paging enabled. Once the boot processor is done
+ * booting, the boot stack becomes the stack of this CPU's idle task.
+ */
+static void smp_ap_main() {
+    cpu_t* cpu = &cpus[starting];
+
+    gdt_init_cpu(cpu->id, cpu->kernel_stack);
+    idt_load();
+    lapic_init_ap();
+    fpu_init_ap();
+    syscall_init_ap();
+
+    cpu->online = true;
+
+    // The boot processor holds the lock until it enters userspace
+    smp_kernel_lock();
+
+    timer_init_ap();
+    proc_init_ap(cpu->kernel_stack);
+}
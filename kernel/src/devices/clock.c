@@ -0,0 +1,81 @@
+#include <kernel/clock.h>
+#include <kernel/cpu.h>
+#include <kernel/timer.h>
+#include <kernel/sys.h>
+
+/* Monotonic clock with nanosecond resolution, counting from `init_clock`.
+ * It reads the TSC when the CPU has one, and falls back to timer ticks.
+ * TSC cycles are converted to nanoseconds by multiplying them by
+ * `ns_per_cycle`, a 32.32 fixed point number, which avoids divisions when
+ * reading the clock.
+ */
+
+static bool use_tsc = false;
+static uint64_t tsc_base;
+static uint64_t ns_per_cycle;
+static uint32_t tick_base;
+
+/* Calibrates the TSC against the PIT.
+ */
+void init_clock() {
+    tick_base = timer_get_tick();
+
+    if (!cpu_has_feature_edx(CPUID_FEAT_EDX_TSC)) {
+        printk("no TSC, falling back to tick-based time");
+        return;
+    }
+
+    uint64_t start = cpu_rdtsc();
+    timer_pit_wait(TIMER_CALIBRATION_MS);
+    uint64_t cycles = cpu_rdtsc() - start;
+
+    uint32_t khz = cycles / TIMER_CALIBRATION_MS;
+
+    if (!khz) {
+        printke("failed to calibrate the TSC");
+        return;
+    }
+
+    ns_per_cycle = (1000000ull << 32) / khz;
+    tsc_base = cpu_rdtsc();
+    use_tsc = true;
+    timer_use_clock();
+
+    printk("TSC running at %d MHz", khz / 1000);
+}
+
+/* Returns the number of nanoseconds elapsed since `init_clock`.
+ */
+uint64_t clock_get_ns() {
+    if (!use_tsc) {
+        return (uint64_t) (timer_get_tick() - tick_base) * (1000000000 / TIMER_FREQ);
+    }
+
+    return clock_cycles_to_ns(cpu_rdtsc() - tsc_base);
+}
+
+/* Converts a number of TSC cycles to nanoseconds. Returns 0 if the TSC isn't
+ * used.
+ */
+uint64_t clock_cycles_to_ns(uint64_t cycles) {
+    if (!use_tsc) {
+        return 0;
+    }
+
+    /* (cycles * ns_per_cycle) >> 32, computed by 32 bits halves as the full
+     * product would take 128 bits. */
+    uint64_t c_hi = cycles >> 32, c_lo = (uint32_t) cycles;
+    uint64_t m_hi = ns_per_cycle >> 32, m_lo = (uint32_t) ns_per_cycle;
+
+    return ((c_hi * m_hi) << 32) + c_hi * m_lo + c_lo * m_hi + ((c_lo * m_lo) >> 32);
+}
+
+/* Exposes what's needed to compute the clock from the TSC without the kernel.
+ * Returns false if the clock isn't based on the TSC.
+ */
+bool clock_get_tsc_params(uint64_t* base, uint64_t* mult) {
+    *base = tsc_base;
+    *mult = ns_per_cycle;
+
+    return use_tsc;
+}
@@ -1,20 +1,54 @@
 #include <kernel/fpu.h>
 #include <kernel/isr.h>
+#include <kernel/cmdline.h>
+#include <kernel/smp.h>
 #include <kernel/sys.h>
 
 #include <string.h>
 
 #define CR0_MP (1 << 1)
 #define CR0_EM (1 << 2)
+#define CR0_TS (1 << 3)
 #define CR4_OSFXSR (1 << 9)
 #define CR4_OSXMMEXCPT (1 << 10)
 
+#define FPU_DEFAULT_FCW 0x037F
+#define FPU_DEFAULT_MXCSR 0x1F80
+
 void fpu_exception_handler(registers_t* regs);
+static void fpu_not_available_handler(registers_t* regs);
 
-/* Instructions to read and write FPU context require a 16-bytes aligned buffer */
-static uint8_t kernel_fpu[512] __attribute__((aligned(16)));
+/* Instructions to read and write FPU context require a 16-bytes aligned buffer.
+ * Each CPU has its own FPU, hence its own copy of everything below. */
+static uint8_t kernel_fpu[CPU_MAX][512] __attribute__((aligned(16)));
 
-void init_fpu() {
+/* In lazy mode, the FPU keeps the state of `fpu_owner` across switches and
+ * kernel entries. CR0.TS is set whenever someone else may use the FPU, so
+ * that their first FPU instruction raises a #NM exception, upon which the
+ * state is swapped. `fpu_owner` is NULL when the kernel last used the FPU.
+ */
+static bool lazy = true;
+static bool ts_set[CPU_MAX];
+static process_t* fpu_owner[CPU_MAX];
+
+static void fpu_set_ts() {
+    uint32_t cr;
+
+    asm volatile("mov %%cr0, %0" : "=r"(cr));
+    asm volatile("mov %0, %%cr0" :: "r"(cr | CR0_TS));
+
+    ts_set[smp_current_cpu()] = true;
+}
+
+static void fpu_clear_ts() {
+    asm volatile("clts");
+
+    ts_set[smp_current_cpu()] = false;
+}
+
+/* Enables the FPU and SSE on the calling CPU.
+ */
+static void fpu_setup_cpu() {
     uint32_t cr;
 
     /* Configure CR0: disable emulation (EM), as we assume we have an FPU, and
@@ -39,8 +73,44 @@ void init_fpu() {
     asm volatile(
         "mov %0, %%cr4\n"
         "fninit" ::"r"(cr));
+}
+
+/* Uses lazy switching unless `fpu=eager` is passed on the command line.
+ */
+void init_fpu() {
+    const char* mode = cmdline_get("fpu");
+
+    lazy = !mode || strcmp(mode, "eager");
+
+    fpu_setup_cpu();
 
     isr_register_handler(19, fpu_exception_handler);
+
+    // Nobody owns the FPU yet
+    if (lazy) {
+        isr_register_handler(7, fpu_not_available_handler);
+        fpu_set_ts();
+    }
+
+    printk("using %s fpu switching", lazy ? "lazy" : "eager");
+}
+
+/* Sets up the FPU of an application processor, see `init_fpu`.
+ */
+void fpu_init_ap() {
+    fpu_setup_cpu();
+
+    if (lazy) {
+        fpu_set_ts();
+    }
+}
+
+/* Sets up the FPU state of a new process as `fninit` would.
+ */
+void fpu_init_process(process_t* proc) {
+    memset(proc->fpu_registers, 0, 512);
+    *(uint16_t*) &proc->fpu_registers[0] = FPU_DEFAULT_FCW;
+    *(uint32_t*) &proc->fpu_registers[24] = FPU_DEFAULT_MXCSR;
 }
 
 /* Whatever process got interrupted last has its fpu state in kernel_fpu.
@@ -48,29 +118,143 @@ void init_fpu() {
  * kernel_fpu in that process's structure, and we load the next process's fpu
  * state into kernel_fpu, which will get picked up by fpu_kernel_exit soon
  * enough.
+ * In lazy mode, we only make sure that CR0.TS is set if the next process
+ * doesn't own the FPU. This matters for new processes, which don't return
+ * through `fpu_kernel_exit`.
  */
 void fpu_switch(process_t* prev, const process_t* next) {
-    memcpy(prev->fpu_registers, kernel_fpu, 512);
-    memcpy(kernel_fpu, next->fpu_registers, 512);
+    uint32_t cpu = smp_current_cpu();
+
+    if (lazy) {
+        if (next != fpu_owner[cpu] && !ts_set[cpu]) {
+            fpu_set_ts();
+        }
+
+        return;
+    }
+
+    fpu_save(prev);
+    fpu_restore(next);
+}
+
+/* Saves the fpu state of the process that last entered the kernel in its
+ * process structure.
+ */
+void fpu_save(process_t* proc) {
+    memcpy(proc->fpu_registers, kernel_fpu[smp_current_cpu()], 512);
+}
+
+/* Makes the given process's fpu state the one restored by `fpu_kernel_exit`.
+ */
+void fpu_restore(const process_t* proc) {
+    memcpy(kernel_fpu[smp_current_cpu()], proc->fpu_registers, 512);
+}
+
+/* Forgets about a process's fpu state, as it's exiting.
+ */
+void fpu_release(const process_t* proc) {
+    for (uint32_t cpu = 0; cpu < CPU_MAX; cpu++) {
+        if (fpu_owner[cpu] == proc) {
+            fpu_owner[cpu] = NULL;
+        }
+    }
+}
+
+/* Returns whether a CPU holds the process's fpu state in its registers rather
+ * than in the process structure, in which case the process can't move to
+ * another CPU.
+ */
+bool fpu_is_loaded(const process_t* proc) {
+    if (!lazy) {
+        return false;
+    }
+
+    for (uint32_t cpu = 0; cpu < CPU_MAX; cpu++) {
+        if (fpu_owner[cpu] == proc) {
+            return true;
+        }
+    }
+
+    return false;
 }
 
 /* Called when execution enters the kernel: the fpu state is saved, then
  * cleared, so the kernel gets a fresh start.
+ * In lazy mode, we only make sure that the kernel's own use of the FPU, if
+ * any, raises a #NM exception so that the owner's state is saved first.
  */
 void fpu_kernel_enter() {
+    uint32_t cpu = smp_current_cpu();
+
+    if (lazy) {
+        if (!ts_set[cpu]) {
+            fpu_set_ts();
+        }
+
+        return;
+    }
+
     asm volatile (
         "fxsave (%0)\n"
-        "fninit\n" :: "r" (kernel_fpu));
+        "fninit\n" :: "r" (kernel_fpu[cpu]));
 }
 
 /* Restores the process's fpu state upon returning from the kernel.
+ * In lazy mode, when returning to userspace, lets the process use the FPU
+ * directly if its state is loaded, and makes sure it traps otherwise.
  */
-void fpu_kernel_exit() {
-    asm volatile ("fxrstor (%0)" :: "r" (kernel_fpu));
+void fpu_kernel_exit(registers_t* regs) {
+    uint32_t cpu = smp_current_cpu();
+
+    if (lazy) {
+        if ((regs->cs & 3) != 3) {
+            return;
+        }
+
+        bool owned = fpu_owner[cpu] == current_process;
+
+        if (owned && ts_set[cpu]) {
+            fpu_clear_ts();
+        } else if (!owned && !ts_set[cpu]) {
+            fpu_set_ts();
+        }
+
+        return;
+    }
+
+    asm volatile ("fxrstor (%0)" :: "r" (kernel_fpu[cpu]));
+}
+
+/* Raised by the first FPU instruction executed while CR0.TS is set. If it
+ * comes from userspace, the current process becomes the owner of the FPU,
+ * otherwise the kernel gets a fresh FPU. Either way, the previous owner's
+ * state is saved.
+ */
+static void fpu_not_available_handler(registers_t* regs) {
+    bool from_user = (regs->cs & 3) == 3;
+    process_t** owner = &fpu_owner[smp_current_cpu()];
+
+    fpu_clear_ts();
+
+    if (from_user && *owner == current_process) {
+        return;
+    }
+
+    if (*owner) {
+        asm volatile ("fxsave (%0)" :: "r" ((*owner)->fpu_registers));
+    }
+
+    if (from_user) {
+        asm volatile ("fxrstor (%0)" :: "r" (current_process->fpu_registers));
+        *owner = current_process;
+    } else {
+        asm volatile ("fninit");
+        *owner = NULL;
+    }
 }
 
 void fpu_exception_handler(registers_t* regs) {
     UNUSED(regs);
 
     printke("an exception occured");
-}
\ No newline at end of file
+}
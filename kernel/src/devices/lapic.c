@@ -0,0 +1,146 @@
+#include <kernel/lapic.h>
+#include <kernel/cpu.h>
+#include <kernel/paging.h>
+#include <kernel/isr.h>
+#include <kernel/timer.h>
+#include <kernel/sys.h>
+
+#include <stdlib.h>
+
+/* Driver for the local APICs. Each CPU uses its own for its timer and to
+ * interrupt the others; external interrupts still go through the 8259 PICs,
+ * which the boot processor's LAPIC forwards in "virtual wire" mode.
+ * Each CPU sees its own LAPIC at the same address.
+ */
+
+static volatile uint32_t* lapic = NULL;
+
+static uint32_t lapic_read(uint32_t reg) {
+    return lapic[reg / 4];
+}
+
+static void lapic_write(uint32_t reg, uint32_t value) {
+    lapic[reg / 4] = value;
+}
+
+static void lapic_spurious_handler(registers_t* regs) {
+    UNUSED(regs);
+}
+
+/* Maps and enables the local APIC, with its timer masked. Returns false if
+ * the CPU doesn't have one. Can be called more than once.
+ */
+bool init_lapic() {
+    if (lapic) {
+        return true;
+    }
+
+    if (!cpu_has_feature_edx(CPUID_FEAT_EDX_APIC) ||
+            !cpu_has_feature_edx(CPUID_FEAT_EDX_MSR)) {
+        return false;
+    }
+
+    uint64_t base = cpu_rdmsr(MSR_APIC_BASE);
+    uintptr_t phys = base & PAGE_FRAME;
+
+    cpu_wrmsr(MSR_APIC_BASE, base | MSR_APIC_BASE_ENABLE);
+
+    // Remap a page of kernel heap to the LAPIC's registers, uncached
+    uintptr_t virt = (uintptr_t) kamalloc(0x1000, 0x1000);
+    page_t* p = paging_get_page(virt, false, 0);
+    *p = phys | PAGE_PRESENT | PAGE_RW | PAGE_NOCACHE;
+    paging_invalidate_page(virt);
+
+    lapic = (volatile uint32_t*) virt;
+
+    isr_register_handler(LAPIC_SPURIOUS_VECTOR, lapic_spurious_handler);
+
+    // Keep receiving PIC interrupts through LINT0, NMIs through LINT1
+    lapic_write(LAPIC_LVT_LINT0, LAPIC_LVT_EXTINT);
+    lapic_write(LAPIC_LVT_LINT1, LAPIC_LVT_NMI);
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+
+    return true;
+}
+
+/* Enables the calling application processor's LAPIC, already mapped by the
+ * boot processor. Only the boot processor receives PIC interrupts.
+ */
+void lapic_init_ap() {
+    uint64_t base = cpu_rdmsr(MSR_APIC_BASE);
+    cpu_wrmsr(MSR_APIC_BASE, base | MSR_APIC_BASE_ENABLE);
+
+    lapic_write(LAPIC_LVT_LINT0, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_LVT_LINT1, LAPIC_LVT_NMI);
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TICK_VECTOR);
+}
+
+/* Returns the ID of the calling CPU's LAPIC.
+ */
+uint32_t lapic_id() {
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+/* Sends an inter-processor interrupt to the CPU whose LAPIC has the given ID,
+ * and waits for it to be accepted. `command` is the low half of the ICR, see
+ * the `LAPIC_ICR_*` flags.
+ */
+void lapic_send_ipi(uint32_t id, uint32_t command) {
+    lapic_write(LAPIC_ICR_HIGH, id << 24);
+    lapic_write(LAPIC_ICR_LOW, command);
+
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING) {
+        asm volatile ("pause");
+    }
+}
+
+/* Signals the end of the interrupt being handled. Not needed for spurious
+ * interrupts.
+ */
+void lapic_eoi() {
+    lapic_write(LAPIC_EOI, 0);
+}
+
+/* Returns the number of timer counts elapsed during `ms` milliseconds, as
+ * measured by the PIT. Leaves the timer stopped.
+ */
+uint32_t lapic_timer_calibrate(uint32_t ms) {
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFF);
+
+    timer_pit_wait(ms);
+
+    uint32_t elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURR);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+
+    return elapsed;
+}
+
+/* Arms the timer to fire once, after `count` counts.
+ */
+void lapic_timer_oneshot(uint32_t count) {
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, count);
+}
+
+/* Arms the timer to fire every `count` counts, with `LAPIC_TICK_VECTOR`.
+ */
+void lapic_timer_periodic(uint32_t count) {
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_PERIODIC | LAPIC_TICK_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, count);
+}
+
+/* Returns the number of counts left before the timer fires, 0 if it already
+ * did.
+ */
+uint32_t lapic_timer_current() {
+    return lapic_read(LAPIC_TIMER_CURR);
+}
@@ -1,5 +1,6 @@
 #include <kernel/serial.h>
 #include <kernel/com.h>
+#include <kernel/irq.h>
 #include <kernel/sys.h>
 
 #include <string.h>
@@ -37,9 +38,11 @@ int serial_is_transmit_empty() {
 }
 
 /* Writes a byte to the serial port, and to an internal buffer for debugging
- * purposes.
+ * purposes. Kernel threads may be interrupted by handlers that log too.
  */
 void serial_write(char c) {
+    uint32_t eflags = irq_save();
+
     while (serial_is_transmit_empty() == 0);
 
     outportb(SERIAL_PORT, c);
@@ -51,6 +54,17 @@ void serial_write(char c) {
 
     kernel_log[log_index] = c;
     log_index = (log_index + 1) % (BUF_SIZE - 1);
+    irq_restore(eflags);
+}
+
+/* Writes bytes to the serial port without logging them, e.g. binary data.
+ */
+void serial_write_raw(const uint8_t* buf, uint32_t size) {
+    for (uint32_t i = 0; i < size; i++) {
+        while (serial_is_transmit_empty() == 0);
+
+        outportb(SERIAL_PORT, buf[i]);
+    }
 }
 
 char* serial_get_log() {
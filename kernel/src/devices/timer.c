@@ -1,16 +1,75 @@
 #include <kernel/timer.h>
+#include <kernel/clock.h>
+#include <kernel/cpu.h>
+#include <kernel/lapic.h>
+#include <kernel/cmdline.h>
 #include <kernel/com.h>
+#include <kernel/smp.h>
+#include <kernel/sys.h>
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <list.h>
 
 static uint32_t current_tick;
 static list_t callbacks;
 
+/* In tickless mode, the LAPIC timer is armed in one-shot mode for the next
+ * deadline only, and `current_tick` is brought up to date whenever it's
+ * needed, see `timer_sync`.
+ * A one-shot timer stops counting when it expires, and its interrupt may be
+ * delivered long after that if interrupts are masked, so its count can't
+ * tell how much time passed since it was armed. Once the TSC-based clock is
+ * calibrated, it becomes the time source and the LAPIC timer only provides
+ * interrupts. Until then, early in the boot, the LAPIC count is used.
+ * All of this concerns the boot processor, which keeps time. Application
+ * processors get periodic ticks from their own LAPIC timer, only to run their
+ * scheduler, see `timer_init_ap`.
+ */
+static bool tickless = false;
+static uint32_t counts_per_tick; // LAPIC timer counts in a tick
+static uint32_t last_count;      // LAPIC timer count at the last sync
+static uint32_t carry;           // Counts elapsed in the current tick
+
+static bool use_clock = false;   // See `timer_use_clock`
+static uint64_t clock_base;      // Clock time at which...
+static uint32_t tick_base;       // ... this tick began
+
+static handler_t sampler = NULL; // See `timer_start_sampling`
+static bool sampler_irq = false; // Whether IRQ0 calls `sampler`
+
+static void timer_lapic_callback(registers_t* regs);
+static void timer_ap_callback(registers_t* regs);
+
+/* Uses the LAPIC timer in one-shot mode if there's one, unless `nohz=off` is
+ * passed on the command line. Falls back to periodic ticks from the PIT.
+ */
 void init_timer() {
     callbacks = LIST_HEAD_INIT(callbacks);
 
+    const char* nohz = cmdline_get("nohz");
+    bool want_tickless = !nohz || strcmp(nohz, "off");
+
+    // Tickless mode needs the TSC to keep time, see `timer_sync`
+    if (want_tickless && cpu_has_feature_edx(CPUID_FEAT_EDX_TSC) && init_lapic()) {
+        uint32_t counts = lapic_timer_calibrate(TIMER_CALIBRATION_MS);
+        counts_per_tick = counts * (1000 / TIMER_FREQ) / TIMER_CALIBRATION_MS;
+
+        if (counts_per_tick) {
+            tickless = true;
+            isr_register_handler(LAPIC_TIMER_VECTOR, &timer_lapic_callback);
+            timer_set_next_tick(0);
+
+            printk("tickless mode, %d LAPIC timer counts per tick",
+                counts_per_tick);
+
+            return;
+        }
+
+        printke("failed to calibrate the LAPIC timer");
+    }
+
     irq_register_handler(IRQ0, &timer_callback);
 
     uint32_t divisor = TIMER_QUOTIENT / TIMER_FREQ;
@@ -20,26 +79,209 @@ void init_timer() {
     outportb(PIT_0, (divisor >> 8) & 0xFF);
 }
 
-void timer_callback(registers_t* regs) {
-    current_tick++;
+/* Prepares the ticks of application processors, before they're started.
+ * Needs the LAPIC, which periodic ticks from the PIT don't use otherwise.
+ */
+void timer_init_smp() {
+    if (!counts_per_tick) {
+        uint32_t counts = lapic_timer_calibrate(TIMER_CALIBRATION_MS);
+        counts_per_tick = counts * (1000 / TIMER_FREQ) / TIMER_CALIBRATION_MS;
+    }
+
+    isr_register_handler(LAPIC_TICK_VECTOR, &timer_ap_callback);
+}
+
+/* Starts the periodic ticks of the calling application processor.
+ */
+void timer_init_ap() {
+    lapic_timer_periodic(counts_per_tick);
+}
 
+static void timer_run_callbacks(registers_t* regs) {
     handler_t* callback;
     list_for_each_entry(callback, &callbacks) {
         (*callback)(regs);
     }
 }
 
+/* Periodic PIT interrupt handler.
+ */
+void timer_callback(registers_t* regs) {
+    current_tick++;
+
+    if (sampler) {
+        sampler(regs);
+    }
+
+    timer_run_callbacks(regs);
+}
+
+/* PIT interrupt handler in tickless mode, only used for sampling.
+ */
+static void timer_sampler_callback(registers_t* regs) {
+    if (sampler) {
+        sampler(regs);
+    }
+}
+
+/* Brings the tick count up to date, and `carry` with it.
+ */
+static void timer_sync() {
+    if (use_clock) {
+        uint64_t elapsed = clock_get_ns() - clock_base;
+        uint32_t ns = elapsed % TIMER_NS_PER_TICK;
+
+        current_tick = tick_base + elapsed / TIMER_NS_PER_TICK;
+        carry = (uint64_t) ns * counts_per_tick / TIMER_NS_PER_TICK;
+
+        return;
+    }
+
+    // Only the boot processor's LAPIC timer runs in one-shot mode
+    if (smp_current_cpu() != 0) {
+        return;
+    }
+
+    // Counts elapsed since the last call
+    uint32_t count = lapic_timer_current();
+    uint32_t elapsed = carry + last_count - count;
+
+    current_tick += elapsed / counts_per_tick;
+    carry = elapsed % counts_per_tick;
+    last_count = count;
+}
+
+/* Makes the TSC-based clock the time source in tickless mode. Called once the
+ * clock is calibrated, see `init_clock`.
+ */
+void timer_use_clock() {
+    if (!tickless) {
+        return;
+    }
+
+    timer_sync();
+    tick_base = current_tick;
+    clock_base = clock_get_ns() - (uint64_t) carry * TIMER_NS_PER_TICK / counts_per_tick;
+    use_clock = true;
+}
+
+/* One-shot LAPIC timer interrupt handler. The timer is rearmed as late as
+ * possible so that time keeps flowing; callbacks are expected to ask for an
+ * earlier deadline if they need one.
+ */
+static void timer_lapic_callback(registers_t* regs) {
+    lapic_eoi();
+    timer_set_next_tick(0);
+    timer_run_callbacks(regs);
+}
+
+/* Periodic LAPIC timer interrupt handler of application processors. The tick
+ * count is left to the boot processor.
+ */
+static void timer_ap_callback(registers_t* regs) {
+    lapic_eoi();
+    timer_run_callbacks(regs);
+}
+
+/* Asks for the timer interrupt to fire in `delay` ticks, replacing the
+ * previous deadline. A `delay` of 0 means as late as the hardware allows.
+ * Does nothing with periodic ticks, which fire anyway, as on application
+ * processors.
+ */
+void timer_set_next_tick(uint32_t delay) {
+    if (!tickless || smp_current_cpu() != 0) {
+        return;
+    }
+
+    uint32_t max_delay = 0xFFFFFFFF / counts_per_tick - 1;
+
+    if (!delay || delay > max_delay) {
+        delay = max_delay;
+    }
+
+    timer_sync();
+
+    last_count = delay * counts_per_tick - carry;
+    lapic_timer_oneshot(last_count);
+}
+
+/* Busy-waits for `ms` milliseconds, at most 50, using channel 2 of the PIT.
+ * Meant to calibrate other clocks, as it doesn't need interrupts.
+ */
+void timer_pit_wait(uint32_t ms) {
+    uint32_t count = TIMER_QUOTIENT * ms / 1000;
+
+    // Disconnect the speaker, and hold channel 2's gate low while setting up
+    uint8_t port_b = inportb(PIT_PORT_B) & ~(PIT_PORT_B_SPEAKER | PIT_PORT_B_GATE2);
+    outportb(PIT_PORT_B, port_b);
+
+    outportb(PIT_CMD, PIT_SET_CH2_ONESHOT);
+    outportb(PIT_2, count & 0xFF);
+    outportb(PIT_2, (count >> 8) & 0xFF);
+
+    // Start counting, the channel's output goes high when done
+    outportb(PIT_PORT_B, port_b | PIT_PORT_B_GATE2);
+
+    while (!(inportb(PIT_PORT_B) & PIT_PORT_B_OUT2)) { }
+}
+
+/* Calls `handler` with the interrupted registers about `freq` times per second
+ * until `timer_stop_sampling` is called. In tickless mode, the PIT is free to
+ * interrupt at that frequency; otherwise samples are taken on periodic ticks.
+ * Returns the frequency actually used.
+ */
+uint32_t timer_start_sampling(handler_t handler, uint32_t freq) {
+    sampler = handler;
+
+    if (!tickless) {
+        return TIMER_FREQ;
+    }
+
+    // The PIT's divisor is 16 bits wide
+    freq = freq < TIMER_SAMPLING_MIN ? TIMER_SAMPLING_MIN : freq;
+    freq = freq > TIMER_SAMPLING_MAX ? TIMER_SAMPLING_MAX : freq;
+
+    uint32_t divisor = TIMER_QUOTIENT / freq;
+
+    outportb(PIT_CMD, PIT_SET);
+    outportb(PIT_0, divisor & 0xFF);
+    outportb(PIT_0, (divisor >> 8) & 0xFF);
+
+    if (!sampler_irq) {
+        irq_register_handler(IRQ0, &timer_sampler_callback);
+        sampler_irq = true;
+    } else {
+        irq_unmask(IRQ0);
+    }
+
+    return TIMER_QUOTIENT / divisor;
+}
+
+void timer_stop_sampling() {
+    sampler = NULL;
+
+    if (sampler_irq) {
+        irq_mask(IRQ0);
+    }
+}
+
 uint32_t timer_get_tick() {
+    if (tickless) {
+        timer_sync();
+    }
+
     return current_tick;
 }
 
 /* Returns the time since boot in seconds
  */
 float timer_get_time() {
-    return current_tick * (1.0f / TIMER_FREQ);
+    return timer_get_tick() * (1.0f / TIMER_FREQ);
 }
 
 /* Registers a callback to be called on each timer tick.
+ * In tickless mode, callbacks are only called when the deadline set with
+ * `timer_set_next_tick` is reached, and several ticks may have passed.
  */
 void timer_register_callback(handler_t handler) {
     handler_t* callback = (handler_t*) kmalloc(sizeof(handler_t));
@@ -58,4 +300,4 @@ void timer_remove_callback(handler_t handler) {
             return;
         }
     }
-}
\ No newline at end of file
+}
@@ -1,19 +1,28 @@
+#include <kernel/acpi.h>
+#include <kernel/boottime.h>
+#include <kernel/clock.h>
+#include <kernel/cmdline.h>
 #include <kernel/ext2.h>
 #include <kernel/fb.h>
 #include <kernel/fpu.h>
 #include <kernel/fs.h>
+#include <kernel/futex.h>
 #include <kernel/gdt.h>
 #include <kernel/idt.h>
 #include <kernel/irq.h>
+#include <kernel/kinfo.h>
+#include <kernel/module.h>
 #include <kernel/multiboot2.h>
 #include <kernel/paging.h>
 #include <kernel/pmm.h>
 #include <kernel/proc.h>
 #include <kernel/ps2.h>
 #include <kernel/serial.h>
+#include <kernel/smp.h>
 #include <kernel/stacktrace.h>
 #include <kernel/sys.h>
 #include <kernel/syscall.h>
+#include <kernel/systrace.h>
 #include <kernel/term.h>
 #include <kernel/timer.h>
 #include <kernel/wm.h>
@@ -29,8 +38,9 @@ extern uint32_t KERNEL_END_PHYS;
 extern uint32_t KERNEL_SIZE;
 
 void kernel_main(mb2_t* boot, uint32_t magic) {
+    init_boottime();
     init_serial();
-    init_fpu();
+    boottime_mark("serial");
 
     if (magic != MB2_MAGIC) {
         printk("The multiboot magic header is wrong: 0x%X", magic);
@@ -38,50 +48,83 @@ void kernel_main(mb2_t* boot, uint32_t magic) {
     }
 
     init_pmm(boot);
+    boottime_mark("pmm");
     init_paging(boot);
+    boottime_mark("paging");
+    init_cmdline(boot);
+    init_fpu();
+    boottime_mark("cmdline, fpu");
 
     printk("SnowflakeOS 0.7");
     printk("kernel is %d KiB large", ((uint32_t) &KERNEL_SIZE) >> 10);
 
     init_fb(boot);
+    boottime_mark("framebuffer");
+    init_acpi(boot);
+    boottime_mark("acpi");
     init_gdt();
     init_idt();
     init_isr();
     init_irq();
+    boottime_mark("gdt, idt, irq");
     init_syscall();
+    init_systrace();
+    init_futex();
+    boottime_mark("syscalls");
 
     init_timer();
+    boottime_mark("timer");
+    smp_kernel_lock(); // Released when entering userspace, see `proc_enter_usermode`
+    init_smp(); // Needs the PIT and the LAPIC, which the timer sets up
+    boottime_mark("smp");
+    init_clock();
+    boottime_mark("clock");
+    init_kinfo();
     init_ps2();
+    boottime_mark("kinfo, ps2");
 
-    // Load GRUB modules as programs
+    // Use GRUB modules where they were loaded
     mb2_tag_t* tag = boot->tags;
+    bool release = module_release_enabled();
 
     while (tag->type != MB2_TAG_END) {
         if (tag->type == MB2_TAG_MODULE) {
             mb2_tag_module_t* mod = (mb2_tag_module_t*) tag;
             uint32_t size = mod->mod_end - mod->mod_start;
             char* module_name = (char*) mod->name;
+            char phase[BOOT_PHASE_NAME_MAX];
+            bool keep = false;
 
-            uint8_t* data = (uint8_t*) kmalloc(size);
-            memcpy(data, (void*) mod->mod_start, size);
+            uint8_t* data = module_map(mod);
 
-            if (!strcmp(module_name, "disk")) {
+            if (data && !strcmp(module_name, "disk")) {
                 init_fs(init_ext2(data, size));
-            } else if (!strcmp(module_name, "symbols")) {
+                keep = true; // The filesystem lives there
+            } else if (data && !strcmp(module_name, "symbols")) {
                 init_stacktrace(data, size);
             }
 
+            if (data && release && !keep) {
+                module_release(mod, data);
+            }
+
+            snprintf(phase, sizeof(phase), "module %s", module_name);
+            boottime_mark(phase);
             printk("loaded module %s", mod->name);
         }
 
         tag = (mb2_tag_t*) ((uintptr_t) tag + align_to(tag->size, 8));
     }
 
-    init_wm();
     init_proc();
+    boottime_mark("proc");
+    init_wm(); // Needs the scheduler for its thread
+    boottime_mark("wm");
 
     proc_exec("/background", NULL);
+    boottime_mark("exec /background");
     proc_exec("/terminal", NULL);
+    boottime_mark("exec /terminal");
 
     proc_enter_usermode();
 }
@@ -4,6 +4,7 @@
 #include <kernel/stacktrace.h>
 #include <kernel/sys.h>
 #include <kernel/term.h>
+#include <kernel/trace.h>
 
 #include <math.h>
 #include <stdio.h>
@@ -133,9 +134,13 @@ void paging_fault_handler(registers_t* regs) {
 
     uint32_t err = regs->err_code;
     uint32_t pid = proc_get_current_pid();
+
+    proc_account_page_fault();
     uintptr_t cr2 = 0;
     asm volatile("mov %%cr2, %0\n" : "=r"(cr2));
 
+    trace_event(TRACE_PAGE_FAULT, cr2, regs->eip);
+
     printke("page fault caused by instruction at %p from process %d:",
         regs->eip, pid);
     printke("the page at %p %s present ", cr2, err & 0x01 ? "was" : "wasn't");
@@ -163,7 +168,7 @@ void paging_fault_handler(registers_t* regs) {
     }
 
     if (pid) {
-        proc_exit();
+        proc_exit(-1);
     } else {
         abort();
     }
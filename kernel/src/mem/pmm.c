@@ -1,6 +1,7 @@
 #include <kernel/multiboot2.h>
 #include <kernel/paging.h>
 #include <kernel/pmm.h>
+#include <kernel/spinlock.h>
 #include <kernel/sys.h>
 
 #include <math.h>
@@ -15,6 +16,7 @@ static uint32_t mem_size;
 static uint32_t used_blocks;
 static uint32_t max_blocks;
 static uintptr_t kernel_end;
+static spinlock_t lock = SPINLOCK_INIT; // Guards the bitmap and counters
 
 // Linker-provided symbols. Beware, those don't take into account GRUB's things
 extern uint32_t KERNEL_END;
@@ -127,6 +129,8 @@ void pmm_deinit_region(uintptr_t addr, uint32_t size) {
  * Note: of course, this address is page-aligned.
  */
 uintptr_t pmm_alloc_page() {
+    spinlock_acquire(&lock);
+
     if (max_blocks - used_blocks <= 0) {
         printke("kernel is out of physical memory!");
         abort();
@@ -134,11 +138,11 @@ uintptr_t pmm_alloc_page() {
 
     uint32_t block = mmap_find_free();
 
-    if (!block)  {
-        return 0;
+    if (block) {
+        mmap_set(block);
     }
 
-    mmap_set(block);
+    spinlock_release(&lock);
 
     return (uintptr_t) (block*PMM_BLOCK_SIZE);
 }
@@ -150,13 +154,16 @@ uintptr_t pmm_alloc_page() {
  * address that is 4 MiB-aligned. Return that, mark 4 MiB as taken.
  */
 uintptr_t pmm_alloc_aligned_large_page() { // TODO: generalize
-    if (max_blocks - used_blocks < 2*1024) { // 4MiB
-        return 0;
-    }
+    spinlock_acquire(&lock);
 
-    uint32_t free_block = mmap_find_free_frame(2*1024);
+    uint32_t free_block = 0;
+
+    if (max_blocks - used_blocks >= 2*1024) { // 4MiB
+        free_block = mmap_find_free_frame(2*1024);
+    }
 
     if (!free_block) {
+        spinlock_release(&lock);
         return 0;
     }
 
@@ -166,38 +173,49 @@ uintptr_t pmm_alloc_aligned_large_page() { // TODO: generalize
         mmap_set(aligned_block + i);
     }
 
+    spinlock_release(&lock);
+
     return (uintptr_t)(aligned_block*PMM_BLOCK_SIZE);
 }
 
 uintptr_t pmm_alloc_pages(uint32_t num) {
-    if (max_blocks-used_blocks < num) {
-        return 0;
-    }
+    spinlock_acquire(&lock);
 
-    uint32_t first_block = mmap_find_free_frame(num);
+    uint32_t first_block = 0;
 
-    if (!first_block) {
-        return 0;
+    if (max_blocks-used_blocks >= num) {
+        first_block = mmap_find_free_frame(num);
     }
 
-    for (uint32_t i = 0; i < num; i++) {
-        mmap_set(first_block+i);
+    if (first_block) {
+        for (uint32_t i = 0; i < num; i++) {
+            mmap_set(first_block+i);
+        }
     }
 
+    spinlock_release(&lock);
+
     return (uintptr_t) (first_block*PMM_BLOCK_SIZE);
 }
 
 void pmm_free_page(uintptr_t addr) {
     uint32_t block = addr/PMM_BLOCK_SIZE;
+
+    spinlock_acquire(&lock);
     mmap_unset(block);
+    spinlock_release(&lock);
 }
 
 void pmm_free_pages(uintptr_t addr, uint32_t num) {
     uint32_t first_block = addr/PMM_BLOCK_SIZE;
 
+    spinlock_acquire(&lock);
+
     for (uint32_t i = 0; i < num; i++) {
         mmap_unset(first_block+i);
     }
+
+    spinlock_release(&lock);
 }
 
 void mmap_set(uint32_t bit) {
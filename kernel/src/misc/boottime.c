@@ -0,0 +1,92 @@
+#include <kernel/boottime.h>
+#include <kernel/clock.h>
+#include <kernel/cpu.h>
+#include <kernel/sys.h>
+
+#include <string.h>
+
+/* Boot timeline: each phase of the boot is timed by reading the TSC when it
+ * ends, and its name is recorded along. Phases run back to back, so a phase
+ * starts when the previous one ended, and the first one when the kernel was
+ * entered.
+ * The TSC is only calibrated by `init_clock`, so cycles are kept raw and
+ * converted when the timeline is read.
+ * The timeline ends with the first frame of the desktop, see `wm_compose`.
+ */
+
+typedef struct {
+    char name[BOOT_PHASE_NAME_MAX];
+    uint64_t end;
+} boot_mark_t;
+
+static boot_mark_t marks[BOOT_PHASE_MAX];
+static uint32_t mark_count = 0;
+static uint64_t boot_start;
+static bool enabled = false;
+static bool done = false;
+
+/* Must be called first thing in the kernel.
+ */
+void init_boottime() {
+    if (!cpu_has_feature_edx(CPUID_FEAT_EDX_TSC)) {
+        return;
+    }
+
+    boot_start = cpu_rdtsc();
+    enabled = true;
+}
+
+/* Ends the current boot phase, naming it `name`.
+ */
+void boottime_mark(const char* name) {
+    if (!enabled || done || mark_count == BOOT_PHASE_MAX) {
+        return;
+    }
+
+    boot_mark_t* mark = &marks[mark_count++];
+
+    mark->end = cpu_rdtsc();
+    strncpy(mark->name, name, BOOT_PHASE_NAME_MAX - 1);
+    mark->name[BOOT_PHASE_NAME_MAX - 1] = '\0';
+}
+
+/* Ends the last boot phase and prints the timeline. Only the first call does
+ * anything.
+ */
+void boottime_done(const char* name) {
+    if (!enabled || done) {
+        return;
+    }
+
+    static boot_phase_t phases[BOOT_PHASE_MAX];
+
+    boottime_mark(name);
+    done = true;
+
+    uint32_t count = boottime_get_phases(phases);
+
+    printk("boot timeline, in microseconds:");
+    printk("%8s %8s  %s", "start", "duration", "phase");
+
+    for (uint32_t i = 0; i < count; i++) {
+        printk("%8u %8u  %s", phases[i].start, phases[i].duration, phases[i].name);
+    }
+
+    printk("booted in %u ms", (phases[count - 1].start + phases[count - 1].duration) / 1000);
+}
+
+/* Fills `phases` with the phases recorded so far, which must hold
+ * `BOOT_PHASE_MAX` of them, and returns their number.
+ */
+uint32_t boottime_get_phases(boot_phase_t* phases) {
+    uint64_t last = boot_start;
+
+    for (uint32_t i = 0; i < mark_count; i++) {
+        strcpy(phases[i].name, marks[i].name);
+        phases[i].start = clock_cycles_to_ns(last - boot_start) / 1000;
+        phases[i].duration = clock_cycles_to_ns(marks[i].end - last) / 1000;
+        last = marks[i].end;
+    }
+
+    return mark_count;
+}
@@ -159,6 +159,7 @@ int32_t ext2_rename(ext2_fs_t* fs, uint32_t dir_ino, uint32_t ino, uint32_t dest
 uint32_t ext2_mkdir(ext2_fs_t* fs, const char* name, uint32_t parent_inode);
 uint32_t ext2_read(ext2_fs_t* fs, uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t size);
 uint32_t ext2_append(ext2_fs_t* fs, uint32_t inode, uint8_t* data, uint32_t size);
+uint32_t ext2_write(ext2_fs_t* fs, uint32_t inode, uint32_t offset, uint8_t* data, uint32_t size);
 sos_directory_entry_t* ext2_readdir(ext2_fs_t* fs, uint32_t inode, uint32_t offset);
 inode_t* ext2_get_fs_inode(ext2_fs_t* fs, uint32_t inode);
 int32_t ext2_close(ext2_fs_t* fs, uint32_t ino);
@@ -173,6 +174,7 @@ static superblock_t* parse_superblock(ext2_fs_t* fs);
 static group_descriptor_t* parse_group_descriptors(ext2_fs_t* fs);
 static void read_inode_block(ext2_fs_t* fs, ext2_inode_t* inode, uint32_t n, uint8_t* buf);
 static void write_inode_block(ext2_fs_t* fs, ext2_inode_t* inode, uint32_t n, uint8_t* buf);
+static void write_inode_data(ext2_fs_t* fs, ext2_inode_t* inode, uint32_t offset, uint8_t* data, uint32_t size);
 static ext2_inode_t* get_inode(ext2_fs_t* fs, uint32_t inode);
 static uint32_t allocate_block(ext2_fs_t* fs);
 static void free_block(ext2_fs_t* fs, uint32_t block);
@@ -206,6 +208,7 @@ fs_t* init_ext2(uint8_t* data, uint32_t len) {
     }
 
     e2fs->fs.append = (fs_append_t) ext2_append;
+    e2fs->fs.write = (fs_write_t) ext2_write;
     e2fs->fs.create = (fs_create_t) ext2_create;
     e2fs->fs.rename = (fs_rename_t) ext2_rename;
     e2fs->fs.get_fs_inode = (fs_get_fs_inode_t) ext2_get_fs_inode;
@@ -314,37 +317,25 @@ int32_t ext2_rename(ext2_fs_t* fs, uint32_t dir_ino, uint32_t ino, uint32_t dest
  */
 uint32_t ext2_append(ext2_fs_t* fs, uint32_t inode, uint8_t* data, uint32_t size) {
     ext2_inode_t* in = get_inode(fs, inode);
-    uint8_t* tmp = zalloc(fs->block_size);
 
-    uint32_t start_block = in->size_lower / fs->block_size;
-    uint32_t end_block = (in->size_lower + size) / fs->block_size;
-    uint32_t offset_start = in->size_lower % fs->block_size;
-    uint32_t offset_end = (in->size_lower + size) % fs->block_size;
+    write_inode_data(fs, in, in->size_lower, data, size);
+    update_inode(fs, inode, in);
+    kfree(in);
 
-    if (start_block == end_block) {
-        read_inode_block(fs, in, start_block, tmp);
-        memcpy(tmp + offset_start, data, size);
-        write_inode_block(fs, in, start_block, tmp);
-    } else {
-        for (uint32_t block = start_block; block < end_block; block++) {
-            if (block == start_block) {
-                read_inode_block(fs, in, start_block, tmp);
-                memcpy(tmp + offset_start, data, fs->block_size - offset_start);
-                write_inode_block(fs, in, start_block, tmp);
-            } else {
-                write_inode_block(fs, in, block, data + (block - start_block)*fs->block_size);
-            }
-        }
+    return size;
+}
 
-        if (offset_end) {
-            memcpy(tmp, data + (end_block - start_block)*fs->block_size - offset_start, offset_end);
-            write_inode_block(fs, in, end_block, tmp);
-        }
+/* Writes `size` bytes at `offset` in `inode`, growing it if needed.
+ */
+uint32_t ext2_write(ext2_fs_t* fs, uint32_t inode, uint32_t offset, uint8_t* data, uint32_t size) {
+    ext2_inode_t* in = get_inode(fs, inode);
+
+    if (!in) {
+        return 0;
     }
 
-    in->size_lower += size;
+    write_inode_data(fs, in, offset, data, size);
     update_inode(fs, inode, in);
-    kfree(tmp);
     kfree(in);
 
     return size;
@@ -573,6 +564,34 @@ static void write_inode_block(ext2_fs_t* fs, ext2_inode_t* inode, uint32_t n, ui
     write_block(fs, block, buf);
 }
 
+/* Writes `size` bytes at `offset` in the data of the given inode, updating
+ * its size if it grows. Blocks only partially covered are read first, so that
+ * the rest of their content is kept. The caller must write the inode back.
+ */
+static void write_inode_data(ext2_fs_t* fs, ext2_inode_t* inode, uint32_t offset, uint8_t* data, uint32_t size) {
+    uint8_t* tmp = kmalloc(fs->block_size);
+    uint32_t done = 0;
+
+    while (done < size) {
+        uint32_t block = (offset + done) / fs->block_size;
+        uint32_t block_offset = (offset + done) % fs->block_size;
+        uint32_t len = min(fs->block_size - block_offset, size - done);
+
+        if (len == fs->block_size) {
+            write_inode_block(fs, inode, block, data + done);
+        } else {
+            read_inode_block(fs, inode, block, tmp);
+            memcpy(tmp + block_offset, data + done, len);
+            write_inode_block(fs, inode, block, tmp);
+        }
+
+        done += len;
+    }
+
+    inode->size_lower = max(inode->size_lower, offset + size);
+    kfree(tmp);
+}
+
 /* Returns an inode struct from an inode number.
  * This inode can be freed using `kfree`.
  * Note: doesn't check that the inode is valid.
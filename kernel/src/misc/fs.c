@@ -10,22 +10,107 @@
 
 #define FS(inode) ((inode_t*) inode)->fs
 
+/* Number of buckets of the dentry cache, a power of two.
+ */
+#define DCACHE_SIZE 512
+
 typedef struct tnode_t {
     char* name;
     inode_t* inode;
 } tnode_t;
 
+/* The dentry cache indexes the entries of the VFS tree by parent directory and
+ * name, so that path lookups don't scan directories.
+ * Every entry of a directory is added when its tree level is built, and kept
+ * in sync when entries are created, unlinked or renamed. A lookup that misses
+ * in a built directory is thus authoritative.
+ */
+typedef struct dcache_entry_t {
+    folder_inode_t* dir;
+    uint32_t hash; // Of the name alone
+    uint32_t len;
+    tnode_t* tnode;
+} dcache_entry_t;
+
 char* dirname(const char* p);
 char* basename(const char* p);
 uint32_t tnode_to_directory_entry(tnode_t* tn, sos_directory_entry_t* d_ent, uint32_t size);
 void fs_build_tree_level(folder_inode_t* dir_ino, inode_t* parent);
 
 static tnode_t* root;
+static list_t dcache[DCACHE_SIZE]; // Of `dcache_entry_t`
 
 void init_fs(fs_t* fs) {
+    for (uint32_t i = 0; i < DCACHE_SIZE; i++) {
+        dcache[i] = LIST_HEAD_INIT(dcache[i]);
+    }
+
     fs_mount("/", fs);
 }
 
+/* FNV-1a hash of the `len` first characters of `name`.
+ */
+static uint32_t dcache_hash(const char* name, uint32_t len) {
+    uint32_t hash = 2166136261u;
+
+    for (uint32_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t) name[i]) * 16777619;
+    }
+
+    return hash;
+}
+
+static list_t* dcache_bucket(folder_inode_t* dir, uint32_t hash) {
+    uint32_t key = hash ^ ((uintptr_t) dir * 2654435761u);
+
+    return &dcache[key & (DCACHE_SIZE - 1)];
+}
+
+/* Returns the entry named by the `len` first characters of `name` in `dir`,
+ * NULL if there's none. `dir` must have been built.
+ */
+static tnode_t* dcache_lookup(folder_inode_t* dir, const char* name, uint32_t len) {
+    uint32_t hash = dcache_hash(name, len);
+    list_t* bucket = dcache_bucket(dir, hash);
+    dcache_entry_t* e;
+
+    list_for_each_entry(e, bucket) {
+        if (e->dir == dir && e->hash == hash && e->len == len &&
+                !strncmp(e->tnode->name, name, len)) {
+            return e->tnode;
+        }
+    }
+
+    return NULL;
+}
+
+static void dcache_add(folder_inode_t* dir, tnode_t* tn) {
+    dcache_entry_t* e = kmalloc(sizeof(dcache_entry_t));
+
+    e->dir = dir;
+    e->len = strlen(tn->name);
+    e->hash = dcache_hash(tn->name, e->len);
+    e->tnode = tn;
+
+    list_add(dcache_bucket(dir, e->hash), e);
+}
+
+/* Removes `tn` from the cache, must be called before its name changes.
+ */
+static void dcache_remove(folder_inode_t* dir, tnode_t* tn) {
+    list_t* bucket = dcache_bucket(dir, dcache_hash(tn->name, strlen(tn->name)));
+    list_t* iter;
+    dcache_entry_t* e;
+
+    list_for_each(iter, e, bucket) {
+        if (e->tnode == tn) {
+            kfree(e);
+            list_del(iter);
+            return;
+        }
+    }
+}
+
 void delete_tnode(tnode_t* tn) {
     inode_t* in = tn->inode;
 
@@ -34,12 +119,14 @@ void delete_tnode(tnode_t* tn) {
 
         while (!list_empty(&ind->subfiles)) {
             tnode_t* subtn = list_first_entry(&ind->subfiles, tnode_t);
+            dcache_remove(ind, subtn);
             delete_tnode(subtn);
             list_del(list_first(&ind->subfiles));
         }
 
         while (!list_empty(&ind->subfolders)) {
             tnode_t* subtn = list_first_entry(&ind->subfolders, tnode_t);
+            dcache_remove(ind, subtn);
             delete_tnode(subtn);
             list_del(list_first(&ind->subfolders));
         }
@@ -63,11 +150,13 @@ void fs_build_tree_level(folder_inode_t* inode, inode_t* parent) {
     tn->inode = (inode_t*) inode;
     tn->name = strdup(".");
     list_add(&inode->subfolders, tn);
+    dcache_add(inode, tn);
 
     tn = kmalloc(sizeof(tnode_t));
     tn->inode = parent;
     tn->name = strdup("..");
     list_add(&inode->subfolders, tn);
+    dcache_add(inode, tn);
 
     /* Add the rest of the entries */
     while ((dent = FS(inode)->readdir(FS(inode), inode->ino.inode_no, offset)) != NULL && dent->type != DENT_INVALID) {
@@ -78,6 +167,7 @@ void fs_build_tree_level(folder_inode_t* inode, inode_t* parent) {
             tn->name = strndup(dent->name, dent->name_len_low);
             tn->inode = FS(inode)->get_fs_inode(FS(inode), dent->inode);
             list_add(dent->type == DENT_FILE ? &inode->subfiles : &inode->subfolders, tn);
+            dcache_add(inode, tn);
         }
 
         kfree(dent);
@@ -86,82 +176,108 @@ void fs_build_tree_level(folder_inode_t* inode, inode_t* parent) {
     inode->dirty = false;
 }
 
-/* Returns an inode_t* from a path.
- * `flags` can be one of:
- *  - O_CREAT: create the last component of `path`
- *  - O_CREATD: same, but as a directory
- * TODO: prevent creating duplicate entries.
+/* Returns a pointer to the next component of `path`, skipping separators,
+ * and its length in `len`. Returns NULL if there are no components left.
  */
-inode_t* fs_open(const char* path, uint32_t flags) {
-    char* npath = fs_normalize_path(path);
+static const char* fs_next_component(const char* path, uint32_t* len) {
+    while (*path == '/') {
+        path++;
+    }
 
-    if (!strcmp(npath, "/")) {
-        kfree(npath);
-        return root->inode;
+    if (!*path) {
+        return NULL;
     }
 
-    tnode_t* tnode = root;
-    tnode_t* prev_tnode = NULL;
-    char* part = npath;
-    uint32_t part_len = 0;
-    bool last_part = false;
+    *len = strchrnul(path, '/') - path;
 
-    while (!last_part && tnode != prev_tnode) {
-        folder_inode_t* inode = (folder_inode_t*) tnode->inode;
-        prev_tnode = tnode;
-        part += part_len + 1; // Skip the separator
-        part_len = strchrnul(part, '/') - part;
-        last_part = part[part_len] == '\0';
+    return path;
+}
 
-        // File creation requested: now's the time
-        if (last_part && (flags & O_CREAT || flags & O_CREATD)) {
-            uint32_t new_ino = FS(inode)->create(FS(inode), part,
-                flags & O_CREAT ? DENT_FILE : DENT_DIRECTORY,
-                inode->ino.inode_no);
-
-            tnode_t* new_tn = kmalloc(sizeof(tnode_t));
-            new_tn->inode = FS(inode)->get_fs_inode(FS(inode), new_ino);
-            new_tn->name = strdup(part);
-            list_add(flags & O_CREAT ? &inode->subfiles : &inode->subfolders, new_tn);
-        }
+/* Creates the entry named by the `len` first characters of `name` in `dir`,
+ * as a directory if `flags` contains O_CREATD.
+ */
+static tnode_t* fs_create_entry(folder_inode_t* dir, const char* name,
+        uint32_t len, uint32_t flags) {
+    uint32_t type = flags & O_CREATD ? DENT_DIRECTORY : DENT_FILE;
+    tnode_t* tn = kmalloc(sizeof(tnode_t));
+
+    tn->name = strndup(name, len);
+
+    uint32_t ino = FS(dir)->create(FS(dir), tn->name, type, dir->ino.inode_no);
+
+    tn->inode = FS(dir)->get_fs_inode(FS(dir), ino);
+    list_add(type == DENT_FILE ? &dir->subfiles : &dir->subfolders, tn);
+    dcache_add(dir, tn);
+
+    return tn;
+}
+
+/* Follows `path` from the directory `dir`, one component at a time, building
+ * the directories it enters. Returns NULL if a component doesn't exist, or if
+ * one that isn't the last one isn't a directory.
+ */
+static tnode_t* fs_walk(tnode_t* dir, const char* path, uint32_t flags) {
+    const char* part = path;
+    uint32_t len;
 
-        // Build the tree as needed
-        if (inode->dirty) {
-            fs_build_tree_level(inode, prev_tnode->inode);
+    while ((part = fs_next_component(part, &len))) {
+        if (dir->inode->type != DENT_DIRECTORY) {
+            return NULL;
         }
 
-        // Search the tree, starting with subfolders
-        tnode_t* ent;
-        list_for_each_entry(ent, &inode->subfolders) {
-            if (strlen(ent->name) == part_len &&
-                    !strncmp(ent->name, part, part_len)) {
-                tnode = ent;
+        folder_inode_t* inode = (folder_inode_t*) dir->inode;
+        tnode_t* tn = dcache_lookup(inode, part, len);
+        uint32_t unused;
+        bool last_part = !fs_next_component(part + len, &unused);
 
-                if (((folder_inode_t*) tnode->inode)->dirty) {
-                    fs_build_tree_level((folder_inode_t*) tnode->inode, prev_tnode->inode);
-                }
+        // File creation requested: now's the time
+        if (!tn && last_part && (flags & O_CREAT || flags & O_CREATD)) {
+            tn = fs_create_entry(inode, part, len, flags);
+        }
 
-                break;
-            }
+        if (!tn) {
+            return NULL;
         }
 
-        if (tnode != prev_tnode) {
-            continue;
+        if (tn->inode->type == DENT_DIRECTORY && ((folder_inode_t*) tn->inode)->dirty) {
+            fs_build_tree_level((folder_inode_t*) tn->inode, dir->inode);
         }
 
-        // Not a subfolder: check the subfiles
-        list_for_each_entry(ent, &inode->subfiles) {
-            if (strlen(ent->name) == part_len &&
-                    !strncmp(ent->name, part, part_len)) {
-                tnode = ent;
-                break;
-            }
+        dir = tn;
+        part += len;
+    }
+
+    return dir;
+}
+
+/* Returns an inode_t* from a path.
+ * `flags` can be one of:
+ *  - O_CREAT: create the last component of `path` if it doesn't exist
+ *  - O_CREATD: same, but as a directory
+ * Paths are resolved component by component from the root or the current
+ * directory, each in constant time thanks to the dentry cache.
+ */
+inode_t* fs_open(const char* path, uint32_t flags) {
+    tnode_t* start = root;
+
+    if (((folder_inode_t*) root->inode)->dirty) {
+        fs_build_tree_level((folder_inode_t*) root->inode, root->inode);
+    }
+
+    // The working directory is always absolute
+    if (path[0] != '/') {
+        char* cwd = proc_get_cwd();
+        start = fs_walk(root, cwd, O_RDONLY);
+        kfree(cwd);
+
+        if (!start) {
+            return NULL;
         }
     }
 
-    kfree(npath);
+    tnode_t* tnode = fs_walk(start, path, flags);
 
-    return tnode != prev_tnode ? tnode->inode : NULL;
+    return tnode ? tnode->inode : NULL;
 }
 
 /* Mounts a filesystem at the given path in the existing VFS.
@@ -198,6 +314,7 @@ void fs_mount(const char* mount_point, fs_t* fs) {
     /* Empty its "." and ".." entries */
     while (!list_empty(&mnt_in->subfolders)) {
         tnode_t* tn = list_first_entry(&mnt_in->subfolders, tnode_t);
+        dcache_remove(mnt_in, tn);
         kfree(tn->name);
         kfree(tn);
         list_del(list_first(&mnt_in->subfolders));
@@ -246,6 +363,7 @@ int32_t fs_unlink(const char* path) {
     tnode_t* tn;
     list_for_each(iter, tn, &d_in->subfiles) {
         if (tn->inode->inode_no == in->inode_no) {
+            dcache_remove(d_in, tn);
             kfree(tn->name);
             kfree(tn);
 
@@ -315,6 +433,7 @@ int32_t fs_rename(const char* oldp, const char* newp) {
     tnode_t* tn;
     list_for_each(iter, tn, to_iterate) {
         if (tn->inode->inode_no == old->inode_no) {
+            dcache_remove(src, tn);
             list_del(iter);
             break;
         }
@@ -326,6 +445,7 @@ int32_t fs_rename(const char* oldp, const char* newp) {
     list_t* to_add_to = old->type == DENT_DIRECTORY ?
         &dst->subfolders : &dst->subfiles;
     list_add(to_add_to, tn);
+    dcache_add(dst, tn);
 
     kfree(noldp);
     kfree(nnewp);
@@ -364,6 +484,21 @@ uint32_t fs_write(inode_t* in, uint8_t* buf, uint32_t size) {
     return written;
 }
 
+/* Writes `size` bytes at `offset` in the file, overwriting what was there and
+ * growing the file if needed. `offset` can't be past the end of the file.
+ * Returns 0 if the filesystem can only append, as pipes do.
+ */
+uint32_t fs_pwrite(inode_t* in, uint32_t offset, uint8_t* buf, uint32_t size) {
+    if (!in || !FS(in)->write || offset > in->size) {
+        return 0;
+    }
+
+    uint32_t written = FS(in)->write(FS(in), in->inode_no, offset, buf, size);
+    in->size = max(in->size, offset + written);
+
+    return written;
+}
+
 uint32_t fs_readdir(inode_t* in, uint32_t index, sos_directory_entry_t* d_ent, uint32_t size) {
     if (in->type != DENT_DIRECTORY) {
         printke("not a directory");
@@ -11,43 +11,129 @@ typedef struct _stackframe_t {
     uintptr_t eip;
 } stackframe_t;
 
-static uint8_t* symbols;
-static uint32_t len;
+typedef struct {
+    uintptr_t addr;
+    uint32_t name; // Offset of the NULL-terminated name in `names`
+} symbol_t;
+
+static char* names;
+static symbol_t* symbols;
+static uint32_t symbol_count = 0;
+
+/* Builds a table of the symbols listed in `data`, sorted by address, from the
+ * text symbol map generated at build time, one "<hex address> <name>" per line.
+ * Names are copied, so `data` isn't needed afterwards.
+ */
+void init_stacktrace(const uint8_t* data, uint32_t size) {
+    const char* text = (const char*) data;
+    const char* end = text + size;
+    uint32_t lines = 0;
+    uint32_t used = 0;
+
+    for (uint32_t i = 0; i < size; i++) {
+        lines += text[i] == '\n';
+    }
+
+    // Names take less room than the lines they're on
+    symbols = kmalloc(lines*sizeof(symbol_t));
+    char* buf = kmalloc(size);
+
+    const char* line = text;
+
+    while (line < end) {
+        const char* eol = line;
+
+        while (eol < end && *eol != '\n') {
+            eol++;
+        }
+
+        // The map isn't NULL-terminated, ignore a truncated last line
+        if (eol == end) {
+            break;
+        }
+
+        char* name;
+        uintptr_t addr = strtol(line, &name, 16);
+
+        // Skip malformed lines
+        if (name != line && name < eol && *name == ' ') {
+            uint32_t len = eol - name - 1;
+
+            memcpy(buf + used, name + 1, len);
+            buf[used + len] = '\0';
+            symbols[symbol_count++] = (symbol_t) {
+                .addr = addr,
+                .name = used
+            };
+            used += len + 1;
+        }
+
+        line = eol + 1;
+    }
+
+    names = kmalloc(used);
+    memcpy(names, buf, used);
+    kfree(buf);
+
+    // Insertion sort: the linker map is mostly sorted already
+    for (uint32_t i = 1; i < symbol_count; i++) {
+        symbol_t sym = symbols[i];
+        uint32_t j = i;
 
-void init_stacktrace(uint8_t* data, uint32_t size) {
-    symbols = realloc(data, size + 1); // NULL-terminate the symbol list
-    symbols[size] = 0;
-    len = size;
+        while (j && symbols[j - 1].addr > sym.addr) {
+            symbols[j] = symbols[j - 1];
+            j--;
+        }
+
+        symbols[j] = sym;
+    }
 }
 
-/* Returns a pointer to the start of the symbol corresponding to `*addr`.
- * Returns the symbol's address in `*addr`.
+/* Returns the name of the symbol containing `*addr`, i.e. the last one starting
+ * at or before it, and that symbol's address in `*addr`. Returns NULL if there's
+ * no such symbol.
  */
-char* symbol_for_addr(uintptr_t* addr) {
-    uintptr_t last = 0, current = 0;
-    char* last_sym = 0, * current_sym = 0;
-    char* curr = (char*) symbols;
-
-    while (curr && curr < (char*) symbols + len) {
-        current = strtol(curr, &current_sym, 16);
-        current_sym = current_sym + 1;
-
-        if (!last) {
-            last = current;
-            last_sym = current_sym;
-        }
+static const char* symbol_for_addr(uintptr_t* addr) {
+    uint32_t low = 0, high = symbol_count;
 
-        if (current > *addr) {
-            *addr = last;
-            return last_sym;
+    // Find the first symbol past `*addr`
+    while (low < high) {
+        uint32_t mid = low + (high - low)/2;
+
+        if (symbols[mid].addr <= *addr) {
+            low = mid + 1;
+        } else {
+            high = mid;
         }
+    }
+
+    if (!low) {
+        return NULL;
+    }
 
-        last = current;
-        last_sym = current_sym;
-        curr = strchr(curr, '\n') + 1;
+    *addr = symbols[low - 1].addr;
+
+    return names + symbols[low - 1].name;
+}
+
+/* Copies the name of the kernel symbol containing `addr` to `buf`, truncated
+ * to `size` bytes, and returns the symbol's address. Returns 0 if there's no
+ * such symbol.
+ */
+uintptr_t stacktrace_lookup(uintptr_t addr, char* buf, uint32_t size) {
+    const char* sym = symbol_for_addr(&addr);
+
+    if (!sym || !size) {
+        return 0;
     }
 
-    return NULL;
+    uint32_t n = strlen(sym);
+    n = n < size - 1 ? n : size - 1;
+
+    memcpy(buf, sym, n);
+    buf[n] = '\0';
+
+    return addr;
 }
 
 void stacktrace_print() {
@@ -60,14 +146,10 @@ void stacktrace_print() {
 
     while (stackframe) {
         addr = stackframe->eip;
-        char* sym = symbol_for_addr(&addr);
-        sym = sym ? sym : "<not found>";
-        char* end = strchrnul(sym, '\n');
+        const char* sym = symbol_for_addr(&addr);
 
-        *end = '\0';
-        printk(" %p: %s", addr, sym);
-        *end = '\n';
+        printk(" %p: %s", addr, sym ? sym : "<not found>");
 
         stackframe = stackframe->ebp;
     }
-}
\ No newline at end of file
+}
@@ -1,10 +1,16 @@
 #include <kernel/wm.h>
 #include <kernel/mouse.h>
 #include <kernel/kbd.h>
+#include <kernel/irq.h>
 #include <kernel/sys.h>
+#include <kernel/proc.h>
+#include <kernel/trace.h>
+#include <kernel/boottime.h>
+#include <kernel/workqueue.h>
 
 #include <kernel/fs.h>
 
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
 #include <list.h>
@@ -12,6 +18,24 @@
 
 #define MOUSE_SIZE 16
 #define WM_EVENT_QUEUE_SIZE 5
+#define WM_INPUT_QUEUE_SIZE 64
+
+/* Raw input as received by interrupt handlers, see `wm_process_input`.
+ */
+typedef struct {
+    bool is_mouse;
+    union {
+        mouse_t mouse;
+        kbd_event_t kbd;
+    };
+} wm_input_t;
+
+/* An area of the screen to redraw, see `wm_damage`.
+ */
+typedef struct {
+    uint32_t win_id; // Window to redraw, or 0 to redraw whatever is there
+    rect_t rect; // In window coordinates if `win_id` is set, screen ones otherwise
+} wm_damage_t;
 
 void wm_draw_window(wm_window_t* win, rect_t rect);
 void wm_partial_draw_window(wm_window_t* win, rect_t rect);
@@ -26,6 +50,13 @@ rect_t wm_mouse_to_rect(mouse_t mouse);
 void wm_draw_mouse(rect_t new);
 void wm_mouse_callback(mouse_t curr);
 void wm_kbd_callback(kbd_event_t event);
+void wm_handle_mouse(mouse_t curr);
+void wm_handle_kbd(kbd_event_t event);
+void wm_process_input(void* unused);
+void wm_compose(void* unused);
+void wm_damage(uint32_t win_id, rect_t rect);
+rect_t wm_window_area(wm_window_t* win);
+void wm_send_event(wm_window_t* win, wm_event_t* event);
 
 /* Windows are ordered by z-index in this list, e.g. the foremost window is in
  * the last position.
@@ -36,13 +67,28 @@ static uint32_t id_count = 0;
 static fb_t fb;
 static mouse_t mouse;
 
+/* Input handling and drawing to the screen happen in the WM's kernel thread:
+ * interrupt handlers only queue input, and system calls only queue damage.
+ */
+static workqueue_t* wm_queue;
+static work_t input_work;
+static work_t compose_work;
+static ringbuffer_t* input; // Of `wm_input_t`
+static list_t damage; // Of `wm_damage_t`
+
 void init_wm() {
     fb = fb_get_info();
     windows = LIST_HEAD_INIT(windows);
+    damage = LIST_HEAD_INIT(damage);
 
     mouse.x = fb.width/2;
     mouse.y = fb.height/2;
 
+    input = ringbuffer_new(WM_INPUT_QUEUE_SIZE * sizeof(wm_input_t));
+    input_work = WORK_INIT(wm_process_input, NULL);
+    compose_work = WORK_INIT(wm_compose, NULL);
+    wm_queue = workqueue_new();
+
     mouse_set_callback(wm_mouse_callback);
     kbd_set_callback(wm_kbd_callback);
 }
@@ -58,10 +104,12 @@ uint32_t wm_open_window(fb_t* buff, uint32_t flags) {
         .kfb = *buff,
         .id = ++id_count,
         .flags = flags | WM_NOT_DRAWN,
-        .events = ringbuffer_new(WM_EVENT_QUEUE_SIZE * sizeof(wm_event_t))
+        .events = ringbuffer_new(WM_EVENT_QUEUE_SIZE * sizeof(wm_event_t)),
+        .owner = proc_get_current_pid()
     };
 
     win->kfb.address = (uintptr_t) kmalloc(buff->height*buff->pitch);
+    win->waiters = LIST_HEAD_INIT(win->waiters);
 
     list_add_front(&windows, win);
     wm_assign_position(win);
@@ -79,6 +127,7 @@ void wm_close_window(uint32_t win_id) {
         rect_t rect = rect_from_window(win);
 
         list_del(item);
+        proc_wake_all(&win->waiters);
         ringbuffer_free(win->events);
         kfree((void*) win->kfb.address);
         kfree((void*) win);
@@ -87,14 +136,36 @@ void wm_close_window(uint32_t win_id) {
             wm_raise_window(list_last_entry(&windows, wm_window_t));
         }
 
-        wm_refresh_partial(rect);
+        wm_damage(0, rect);
     } else {
         printke("close: failed to find window of id %d", win_id);
     }
 }
 
+/* Closes the windows left open by the process `pid`, e.g. when it exits.
+ */
+void wm_close_windows_of(uint32_t pid) {
+    wm_window_t* win;
+    bool found = true;
+
+    while (found) {
+        found = false;
+
+        list_for_each_entry(win, &windows) {
+            if (win->owner == pid) {
+                wm_close_window(win->id);
+                found = true;
+                break;
+            }
+        }
+    }
+}
+
 /* System call interface to draw a window. `clip` specifies which part to copy
- * from userspace and redraw. If `clip` is NULL, the whole window is redrawn.
+ * from userspace and redraw, in window coordinates. If `clip` is NULL, the
+ * whole window is redrawn.
+ * The copy has to happen here, in the caller's address space, but the drawing
+ * itself is left to the WM thread.
  */
 void wm_render_window(uint32_t win_id, rect_t* clip) {
     list_t* item = wm_get_window(win_id);
@@ -108,11 +179,8 @@ void wm_render_window(uint32_t win_id, rect_t* clip) {
     wm_window_t* win = list_entry(item, wm_window_t);
 
     if (!clip) {
+        rect = wm_window_area(win);
         clip = &rect;
-        *clip = (rect_t) {
-            .top = 0, .left = 0,
-            .bottom = win->ufb.height - 1, .right = win->ufb.width - 1
-        };
     }
 
     // Copy the window's buffer in the kernel
@@ -124,9 +192,7 @@ void wm_render_window(uint32_t win_id, rect_t* clip) {
         off += win->ufb.pitch;
     }
 
-    // Draw the window for real
-    rect = rect_from_window(win);
-    wm_draw_window(win, *clip);
+    wm_damage(win->id, *clip);
 
     // Mark as drawn once
     if (win->flags & WM_NOT_DRAWN) {
@@ -139,6 +205,7 @@ void wm_get_event(uint32_t win_id, wm_event_t* event) {
 
     if (!item) {
         printke("Get_event: invalid window %d", win_id);
+        memset(event, 0, sizeof(wm_event_t));
         return;
     }
 
@@ -151,6 +218,38 @@ void wm_get_event(uint32_t win_id, wm_event_t* event) {
     }
 }
 
+/* Like `wm_get_event`, but blocks the caller until an event is available
+ * if there is none, or until `timeout` ms have passed if `timeout` isn't 0.
+ * `event->type` is zero if no event came in time.
+ */
+void wm_wait_event(uint32_t win_id, wm_event_t* event, uint32_t timeout) {
+    list_t* item = wm_get_window(win_id);
+
+    if (!item) {
+        printke("wait_event: invalid window %d", win_id);
+        memset(event, 0, sizeof(wm_event_t));
+        return;
+    }
+
+    wm_window_t* win = list_entry(item, wm_window_t);
+
+    if (!ringbuffer_available(win->events)) {
+        proc_wait(&win->waiters, timeout);
+    }
+
+    // The window may have been closed in the meantime
+    wm_get_event(win_id, event);
+}
+
+/* Queues an event for the window to pick up, and wakes up its owner if it's
+ * waiting for one.
+ */
+void wm_send_event(wm_window_t* win, wm_event_t* event) {
+    ringbuffer_write(win->events, sizeof(wm_event_t), (uint8_t*) event);
+    proc_wake_all(&win->waiters);
+    proc_boost(win->owner);
+}
+
 /* Window management stuff */
 
 /* Puts a window to the front, giving it focus.
@@ -174,7 +273,7 @@ void wm_raise_window(wm_window_t* win) {
     if (!focused) {
         focused = win;
         event.type = WM_EVENT_GAINED_FOCUS;
-        ringbuffer_write(win->events, sizeof(wm_event_t), (uint8_t*)&event);
+        wm_send_event(win, &event);
         return;
     }
 
@@ -185,10 +284,10 @@ void wm_raise_window(wm_window_t* win) {
 
     // Change focus only then
     event.type = WM_EVENT_LOST_FOCUS;
-    ringbuffer_write(focused->events, sizeof(wm_event_t), (uint8_t*)&event);
+    wm_send_event(focused, &event);
 
     event.type = WM_EVENT_GAINED_FOCUS;
-    ringbuffer_write(win->events, sizeof(wm_event_t), (uint8_t*)&event);
+    wm_send_event(win, &event);
     focused = win;
 
     list_t* topmost;
@@ -206,7 +305,7 @@ void wm_raise_window(wm_window_t* win) {
 
     // Redraw if possible. Not sure this is this function's responsibility.
     if (!(win->flags & WM_NOT_DRAWN)) {
-        wm_draw_window(win, rect_from_window(win));
+        wm_damage(win->id, wm_window_area(win));
     }
 }
 
@@ -355,6 +454,78 @@ void wm_refresh_partial(rect_t clip) {
     rect_clear_clipped(&to_refresh);
 }
 
+/* Queues an area for the WM thread to redraw, see `wm_damage_t`. Damage to a
+ * window is merged with what's already pending for it: redrawing a bit more
+ * beats redrawing twice.
+ */
+void wm_damage(uint32_t win_id, rect_t rect) {
+    wm_damage_t* d;
+
+    if (win_id) {
+        list_for_each_entry(d, &damage) {
+            if (d->win_id == win_id) {
+                d->rect.top = min(d->rect.top, rect.top);
+                d->rect.left = min(d->rect.left, rect.left);
+                d->rect.bottom = max(d->rect.bottom, rect.bottom);
+                d->rect.right = max(d->rect.right, rect.right);
+                return;
+            }
+        }
+    }
+
+    d = kmalloc(sizeof(wm_damage_t));
+    *d = (wm_damage_t) {
+        .win_id = win_id,
+        .rect = rect
+    };
+
+    list_add(&damage, d);
+    workqueue_push(wm_queue, &compose_work);
+}
+
+/* Runs in the WM thread: redraws the damaged areas of the screen, in the order
+ * they were reported.
+ */
+void wm_compose(void* unused) {
+    UNUSED(unused);
+
+    while (!list_empty(&damage)) {
+        wm_damage_t* d = list_first_entry(&damage, wm_damage_t);
+        list_del(list_first(&damage));
+
+        uint32_t area = (d->rect.right - d->rect.left + 1) *
+            (d->rect.bottom - d->rect.top + 1);
+        trace_event(TRACE_WM_RENDER_BEGIN, d->win_id, area);
+
+        if (!d->win_id) {
+            wm_refresh_partial(d->rect);
+        } else {
+            list_t* item = wm_get_window(d->win_id);
+
+            // The window may have been closed since
+            if (item) {
+                wm_window_t* win = list_entry(item, wm_window_t);
+                rect_t rect = {
+                    .top = d->rect.top + win->pos.y,
+                    .left = d->rect.left + win->pos.x,
+                    .bottom = d->rect.bottom + win->pos.y,
+                    .right = d->rect.right + win->pos.x
+                };
+
+                wm_draw_window(win, rect);
+
+                // The desktop is on screen, boot is over
+                if (win->flags & WM_BACKGROUND) {
+                    boottime_done("desktop first frame");
+                }
+            }
+        }
+
+        trace_event(TRACE_WM_RENDER_END, d->win_id, 0);
+        kfree(d);
+    }
+}
+
 /* Redraws every visible area of the screen.
  */
 void wm_refresh_screen() {
@@ -378,6 +549,15 @@ void wm_print_windows() {
     printf("none\n");
 }
 
+/* Returns the whole window's rect, in window coordinates.
+ */
+rect_t wm_window_area(wm_window_t* win) {
+    return (rect_t) {
+        .top = 0, .left = 0,
+        .bottom = win->ufb.height - 1, .right = win->ufb.width - 1
+    };
+}
+
 /* Returns a list of all windows above `win` that overlap with it.
  */
 list_t* wm_get_windows_above(wm_window_t* win) {
@@ -476,10 +656,58 @@ void wm_draw_mouse(rect_t new) {
     }
 }
 
+/* Called by the mouse and keyboard interrupt handlers: the input is queued
+ * for the WM thread, which does the actual work.
+ */
+void wm_mouse_callback(mouse_t curr) {
+    wm_input_t in = { .is_mouse = true, .mouse = curr };
+
+    ringbuffer_write(input, sizeof(wm_input_t), (uint8_t*) &in);
+    workqueue_push(wm_queue, &input_work);
+}
+
+void wm_kbd_callback(kbd_event_t event) {
+    wm_input_t in = { .is_mouse = false, .kbd = event };
+
+    ringbuffer_write(input, sizeof(wm_input_t), (uint8_t*) &in);
+    workqueue_push(wm_queue, &input_work);
+}
+
+/* Runs in the WM thread: handles the input queued since it last ran. If too
+ * much came in meanwhile, the oldest is lost.
+ */
+void wm_process_input(void* unused) {
+    UNUSED(unused);
+
+    while (true) {
+        wm_input_t in;
+
+        // Interrupt handlers fill the ring
+        uint32_t eflags = irq_save();
+        bool available = ringbuffer_available(input) >= sizeof(wm_input_t);
+
+        if (available) {
+            ringbuffer_read(input, sizeof(wm_input_t), (uint8_t*) &in);
+        }
+
+        irq_restore(eflags);
+
+        if (!available) {
+            break;
+        }
+
+        if (in.is_mouse) {
+            wm_handle_mouse(in.mouse);
+        } else {
+            wm_handle_kbd(in.kbd);
+        }
+    }
+}
+
 /* Handles mouse events. This includes moving the cursor, moving windows along
  * with it, and distributing clicks.
  */
-void wm_mouse_callback(mouse_t raw_curr) {
+void wm_handle_mouse(mouse_t raw_curr) {
     static mouse_t raw_prev;
     static wm_window_t* previously_hovered_win = NULL;
     static wm_window_t* clicked_win = NULL;
@@ -528,7 +756,7 @@ void wm_mouse_callback(mouse_t raw_curr) {
             event.mouse.position.top -= r.top;
             event.mouse.position.left -= r.left;
 
-            ringbuffer_write(clicked_win->events, sizeof(wm_event_t), (uint8_t*) &event);
+            wm_send_event(clicked_win, &event);
         }
     }
 
@@ -565,7 +793,7 @@ void wm_mouse_callback(mouse_t raw_curr) {
             event.mouse.position.top -= r.top;
             event.mouse.position.left -= r.left;
 
-            ringbuffer_write(clicked_win->events, sizeof(wm_event_t), (uint8_t*) &event);
+            wm_send_event(clicked_win, &event);
         }
 
         clicked_win = NULL;
@@ -587,13 +815,13 @@ void wm_mouse_callback(mouse_t raw_curr) {
             if (previously_hovered_win) {
                 event.type = WM_EVENT_MOUSE_EXIT;
 
-                ringbuffer_write(previously_hovered_win->events, sizeof(wm_event_t), (uint8_t*) &event);
+                wm_send_event(previously_hovered_win, &event);
             }
 
             if (under_cursor) {
                 event.type = WM_EVENT_MOUSE_ENTER;
 
-                ringbuffer_write(under_cursor->events, sizeof(wm_event_t), (uint8_t*) &event);
+                wm_send_event(under_cursor, &event);
             }
 
             previously_hovered_win = under_cursor;
@@ -602,7 +830,7 @@ void wm_mouse_callback(mouse_t raw_curr) {
         if (under_cursor) {
             event.type = WM_EVENT_MOUSE_MOVE;
 
-            ringbuffer_write(under_cursor->events, sizeof(wm_event_t), (uint8_t*) &event);
+            wm_send_event(under_cursor, &event);
         }
 
         rect_t prev_pos = wm_mouse_to_rect(prev);
@@ -616,7 +844,7 @@ void wm_mouse_callback(mouse_t raw_curr) {
     raw_prev = raw_curr;
 }
 
-void wm_kbd_callback(kbd_event_t event) {
+void wm_handle_kbd(kbd_event_t event) {
     wm_event_t kbd_event;
 
     if (!list_empty(&windows)) {
@@ -628,7 +856,7 @@ void wm_kbd_callback(kbd_event_t event) {
             kbd_event.kbd.keycode = event.keycode;
             kbd_event.kbd.pressed = event.pressed;
             kbd_event.kbd.repr = event.repr;
-            ringbuffer_write(win->events, sizeof(wm_event_t), (uint8_t*) &kbd_event);
+            wm_send_event(win, &kbd_event);
 
             if (!(win->flags & WM_SKIP_INPUT)) {
                 return;
@@ -0,0 +1,104 @@
+#include <kernel/futex.h>
+#include <kernel/paging.h>
+#include <kernel/proc.h>
+#include <kernel/sys.h>
+
+#include <list.h>
+
+/* Futexes let userspace block on a word of memory until another thread wakes
+ * it up, so that locks only enter the kernel when contended.
+ * Blocked threads are kept in a hash table of wait queues, keyed by the
+ * physical address of the word: the same word may be mapped at different
+ * addresses in different processes.
+ */
+
+static wait_queue_t queues[1 << FUTEX_HASH_BITS];
+
+void init_futex() {
+    for (uint32_t i = 0; i < (1 << FUTEX_HASH_BITS); i++) {
+        queues[i] = LIST_HEAD_INIT(queues[i]);
+    }
+}
+
+/* Returns the physical address of the given aligned userspace word, or 0 if it
+ * isn't mapped.
+ */
+static uintptr_t futex_key(volatile uint32_t* addr) {
+    uintptr_t virt = (uintptr_t) addr;
+
+    if (virt % 4 || virt >= KERNEL_BASE_VIRT) {
+        return 0;
+    }
+
+    page_t* page = paging_get_page(virt & PAGE_FRAME, false, 0);
+
+    if (!page || (*page & (PAGE_PRESENT | PAGE_USER)) != (PAGE_PRESENT | PAGE_USER)) {
+        return 0;
+    }
+
+    return (*page & PAGE_FRAME) + (virt & 0xFFF);
+}
+
+/* Fibonacci hashing: the multiplication spreads the bits of the address into
+ * the upper ones, which we keep.
+ */
+static wait_queue_t* futex_queue(uintptr_t key) {
+    return &queues[(key * 2654435761u) >> (32 - FUTEX_HASH_BITS)];
+}
+
+/* Blocks the current thread until `futex_wake` is called on `addr`, if it
+ * still holds `val`, or for at most `timeout` ms if it isn't 0.
+ * Checking the value and blocking can't be interleaved with a wake up: the
+ * kernel isn't preemptible.
+ * Returns 0 once woken up, or one of `FUTEX_AGAIN` and `FUTEX_TIMEDOUT`.
+ */
+int32_t futex_wait(volatile uint32_t* addr, uint32_t val, uint32_t timeout) {
+    uintptr_t key = futex_key(addr);
+
+    if (!key || *addr != val) {
+        return FUTEX_AGAIN;
+    }
+
+    current_process->futex_key = key;
+    proc_wait(futex_queue(key), timeout);
+
+    // Wakers clear the key, so it's still set if we timed out
+    if (current_process->futex_key) {
+        current_process->futex_key = 0;
+        return FUTEX_TIMEDOUT;
+    }
+
+    return 0;
+}
+
+/* Wakes up at most `count` threads blocked on `addr`, oldest first.
+ * Returns the number of threads woken up.
+ */
+int32_t futex_wake(volatile uint32_t* addr, uint32_t count) {
+    uintptr_t key = futex_key(addr);
+    uint32_t woken = 0;
+
+    if (!key) {
+        return 0;
+    }
+
+    wait_queue_t* queue = futex_queue(key);
+    list_t* iter;
+    process_t* p;
+
+    list_for_each(iter, p, queue) {
+        if (woken == count) {
+            break;
+        }
+
+        if (p->futex_key == key) {
+            // Unblocking `p` takes it off the queue
+            iter = iter->prev;
+            p->futex_key = 0;
+            proc_unblock(p);
+            woken++;
+        }
+    }
+
+    return woken;
+}
@@ -0,0 +1,60 @@
+#include <kernel/kinfo.h>
+#include <kernel/clock.h>
+#include <kernel/fb.h>
+#include <kernel/paging.h>
+#include <kernel/pmm.h>
+#include <kernel/proc.h>
+#include <kernel/syscall.h>
+#include <kernel/timer.h>
+#include <kernel/sys.h>
+
+#include <stdlib.h>
+
+/* The kernel info page is a page of kernel heap that is also mapped read-only
+ * at `KINFO_ADDR` for userspace. That mapping lives in the kernel's part of
+ * the address space, so it's shared by every process created afterwards.
+ */
+
+static kinfo_t* kinfo = NULL;
+
+static void kinfo_timer_callback(registers_t* regs) {
+    UNUSED(regs);
+
+    kinfo_update();
+}
+
+/* Must be called before the first process is created.
+ */
+void init_kinfo() {
+    kinfo = kamalloc(0x1000, 0x1000);
+    memset(kinfo, 0, 0x1000);
+
+    uintptr_t phys = paging_virt_to_phys((uintptr_t) kinfo);
+    paging_map_page(KINFO_ADDR, phys, PAGE_USER);
+
+    kinfo->sysenter = syscall_has_sysenter();
+    kinfo->tsc_valid = clock_get_tsc_params(&kinfo->tsc_base, &kinfo->ns_per_cycle);
+    kinfo->timer_freq = TIMER_FREQ;
+    kinfo->fb = fb_get_info();
+
+    kinfo_update();
+    timer_register_callback(&kinfo_timer_callback);
+}
+
+/* Refreshes the counters of the page. Called on timer interrupts, before
+ * sleeping processes get woken up, and whenever the scheduler runs, as there
+ * may be no timer interrupt for a while in tickless mode.
+ */
+void kinfo_update() {
+    kinfo->seq++;
+    asm volatile ("" ::: "memory");
+
+    kinfo->ticks = timer_get_tick();
+    kinfo->kernel_heap_usage = memory_usage();
+    kinfo->ram_usage = pmm_used_memory();
+    kinfo->ram_total = pmm_total_memory();
+    kinfo->cpu_usage = proc_get_cpu_usage();
+
+    asm volatile ("" ::: "memory");
+    kinfo->seq++;
+}
@@ -1,28 +1,350 @@
 #include <kernel/proc.h>
+#include <kernel/cpu.h>
 #include <kernel/timer.h>
 #include <kernel/paging.h>
 #include <kernel/pmm.h>
 #include <kernel/gdt.h>
 #include <kernel/fpu.h>
 #include <kernel/fs.h>
+#include <kernel/kinfo.h>
 #include <kernel/pipe.h>
 #include <kernel/sys.h>
+#include <kernel/trace.h>
+#include <kernel/cmdline.h>
+#include <kernel/smp.h>
+#include <kernel/wm.h>
 
 #include <kernel/sched_robin.h>
+#include <kernel/sched_mlfq.h>
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-extern uint32_t irq_handler_end;
+extern uint32_t proc_user_entry;
 
-process_t* current_process = NULL;
-sched_t* scheduler = NULL;
+/* What a CPU runs. Each CPU has its own scheduler, which only knows about the
+ * processes placed on that CPU, see `proc_add`. Processes stay there, unless
+ * the CPU is busy and another one has nothing to run, see `proc_steal`.
+ */
+typedef struct {
+    process_t* current;
+    process_t* idle;
+    sched_t* scheduler; // NULL until the CPU runs processes
+    uint32_t idle_ticks; // Ticks spent in the idle task since boot
+    uint32_t last_account_tick;
+    uint64_t last_charge; // When time was last charged, see `proc_charge`
+    bool need_resched; // A kernel thread was woken up, see `proc_preempt`
+} proc_cpu_t;
+
+#define this_cpu (&cpus[smp_current_cpu()])
+
+static proc_cpu_t cpus[CPU_MAX];
+static uint32_t cpu_count = 0; // CPUs running processes
+static sched_t* (*sched_create)(); // Allocates the scheduler of a CPU
 
 static uint32_t next_pid = 1;
-
+static list_t processes;
+static list_t zombies; // Exited processes, see `proc_waitpid`
+static list_t sleepers; // Sorted by wakeup tick, soonest first
+
+static uint32_t usage_mark_tick = 0; // Start of the current usage period
+static uint32_t usage_mark_idle = 0; // Idle ticks of all CPUs at that point
+static uint32_t cpu_usage = 0;
+static bool has_tsc = false;
+
+static void proc_init_idle();
+static void proc_update_peak_rss(process_t* proc);
+
+/* Sets up the scheduler chosen on the kernel command line with `sched=name`,
+ * round robin by default, for the boot processor. Other processors start
+ * running processes once the boot processor enters userspace, see
+ * `proc_init_ap`.
+ */
 void init_proc() {
-    scheduler = sched_robin();
+    const char* sched_name = cmdline_get("sched");
+
+    processes = LIST_HEAD_INIT(processes);
+    zombies = LIST_HEAD_INIT(zombies);
+    sleepers = LIST_HEAD_INIT(sleepers);
+    has_tsc = cpu_has_feature_edx(CPUID_FEAT_EDX_TSC);
+
+    if (sched_name && !strcmp(sched_name, "mlfq")) {
+        sched_create = sched_mlfq;
+    } else {
+        if (sched_name && strcmp(sched_name, "robin")) {
+            printke("unknown scheduler '%s', falling back to robin", sched_name);
+        }
+
+        sched_name = "robin";
+        sched_create = sched_robin;
+    }
+
+    printk("using the %s scheduler", sched_name);
+
+    cpus[0].scheduler = sched_create();
+    cpu_count = 1;
+
+    proc_init_idle();
+}
+
+/* The idle task's code: waits for interrupts until something is runnable.
+ * Interrupts may switch away from it at any point, except while scheduling.
+ * It doesn't hold the kernel lock while halting, see `init_smp`.
+ */
+static void proc_idle_loop() {
+    // We may have been switched to by a CPU holding the lock several times
+    smp_kernel_lock_set_depth(1);
+
+    while (true) {
+        smp_kernel_unlock();
+
+        asm volatile (
+            "sti\n"
+            "hlt\n"
+            "cli\n");
+
+        smp_kernel_lock();
+        proc_schedule();
+    }
+}
+
+/* Creates the idle task of the calling CPU, elected whenever its scheduler has
+ * nothing to run. It runs in ring 0 in the kernel's address space, and isn't
+ * known to the scheduler. `saved_stack` is where `proc_switch_process` finds
+ * its registers, if it's not running yet.
+ */
+static process_t* proc_create_idle(uintptr_t stack_top, uintptr_t saved_stack) {
+    process_t* idle = kamalloc(sizeof(process_t), 16);
+
+    *idle = (process_t) {
+        .pid = 0,
+        .directory = *paging_get_page(0xFFFFF000, false, 0) & PAGE_FRAME,
+        .kernel_stack = stack_top,
+        .saved_kernel_stack = saved_stack,
+        .state = PROC_RUNNABLE,
+        .wait_queue = NULL,
+        .children_exit = LIST_HEAD_INIT(idle->children_exit),
+        .leader = idle,
+        .name = "idle",
+        .cpu = smp_current_cpu()
+    };
+
+    return idle;
+}
+
+/* Creates the boot processor's idle task, first switched to from a process.
+ */
+static void proc_init_idle() {
+    uintptr_t kernel_stack = (uintptr_t) aligned_alloc(4, 0x1000 * PROC_KERNEL_STACK_PAGES);
+    uintptr_t stack_top = kernel_stack + PROC_KERNEL_STACK_PAGES * 0x1000 - 4;
+
+    /* Setup the stack as `proc_switch_process` expects to find it: it will
+     * pop four registers, then return into the idle loop. */
+    uint32_t* stack = (uint32_t*) stack_top;
+    *(--stack) = (uintptr_t) proc_idle_loop;
+    stack -= 4; // %ebx, %esi, %edi, %ebp
+
+    cpus[0].idle = proc_create_idle(stack_top, (uintptr_t) stack);
+}
+
+/* Makes the calling application processor run processes, placed there by
+ * `proc_add` or stolen from other CPUs. It starts in its idle task, which
+ * runs on `stack`, the stack the processor booted with. Never returns.
+ */
+void proc_init_ap(uintptr_t stack) {
+    proc_cpu_t* cpu = this_cpu;
+
+    cpu->scheduler = sched_create();
+    cpu->idle = proc_create_idle(stack, 0);
+    cpu->current = cpu->idle;
+    cpu->last_account_tick = timer_get_tick();
+    cpu->last_charge = has_tsc ? cpu_rdtsc() : 0;
+    cpu_count++;
+
+    proc_idle_loop();
+}
+
+/* Returns the process running on the calling CPU.
+ */
+process_t* proc_get_current() {
+    return this_cpu->current;
+}
+
+/* Returns the number of runnable processes placed on `cpu`, including the one
+ * it's running.
+ */
+static uint32_t proc_cpu_load(uint32_t cpu) {
+    uint32_t load = 0;
+    process_t* p;
+
+    list_for_each_entry(p, &processes) {
+        if (p->cpu == cpu && p->state == PROC_RUNNABLE) {
+            load++;
+        }
+    }
+
+    return load;
+}
+
+/* Returns the CPU with the fewest runnable processes.
+ */
+static uint32_t proc_least_loaded_cpu() {
+    uint32_t best = 0;
+    uint32_t best_load = proc_cpu_load(0);
+
+    for (uint32_t cpu = 1; cpu < CPU_MAX && best_load; cpu++) {
+        if (!cpus[cpu].scheduler) {
+            continue;
+        }
+
+        uint32_t load = proc_cpu_load(cpu);
+
+        if (load < best_load) {
+            best = cpu;
+            best_load = load;
+        }
+    }
+
+    return best;
+}
+
+/* Adds a new process to the process list and to the scheduler of `cpu`.
+ */
+static void proc_add(process_t* p, uint32_t cpu) {
+    p->cpu = cpu;
+
+    list_add(&processes, p);
+    cpus[cpu].scheduler->sched_add(cpus[cpu].scheduler, p);
+
+    if (cpu != smp_current_cpu()) {
+        smp_send_resched(cpu);
+    }
+}
+
+/* Where kernel threads go if their entry point returns: they block forever,
+ * there's nothing to free them for.
+ */
+static void proc_kthread_return() {
+    wait_queue_t never = LIST_HEAD_INIT(never);
+
+    while (true) {
+        proc_wait(&never, 0);
+    }
+}
+
+/* Where kernel threads start: unlike the rest of the kernel, they run with
+ * interrupts enabled, so that interrupts aren't held off while they work.
+ */
+static void proc_kthread_start(kthread_entry_t entry, void* arg) {
+    // We may have been switched to by a CPU holding the lock several times
+    smp_kernel_lock_set_depth(1);
+    STI();
+    entry(arg);
+}
+
+/* Creates a kernel thread running `entry(arg)` and adds it to the scheduler.
+ * Like the idle task, it runs in ring 0 in the kernel's address space. It runs
+ * with interrupts enabled, but isn't preempted: it runs until it blocks, e.g.
+ * in `proc_wait`. State it shares with interrupt handlers must be accessed
+ * with interrupts masked, see `irq_save`. It holds the kernel lock while it
+ * runs, see `init_smp`.
+ */
+process_t* proc_create_kthread(kthread_entry_t entry, void* arg) {
+    process_t* thread = kamalloc(sizeof(process_t), 16);
+    uintptr_t kernel_stack = (uintptr_t) aligned_alloc(4, 0x1000 * PROC_KERNEL_STACK_PAGES);
+    uintptr_t stack_top = kernel_stack + PROC_KERNEL_STACK_PAGES * 0x1000 - 4;
+
+    /* Same as for the idle task, except that `proc_kthread_start` finds its
+     * arguments and return address where a `call` would have put them */
+    uint32_t* stack = (uint32_t*) stack_top;
+    *(--stack) = (uintptr_t) arg;
+    *(--stack) = (uintptr_t) entry;
+    *(--stack) = (uintptr_t) proc_kthread_return;
+    *(--stack) = (uintptr_t) proc_kthread_start;
+    stack -= 4; // %ebx, %esi, %edi, %ebp
+
+    *thread = (process_t) {
+        .pid = next_pid++,
+        .directory = cpus[0].idle->directory,
+        .kernel_stack = stack_top,
+        .saved_kernel_stack = (uintptr_t) stack,
+        .cwd = strdup("/"),
+        .state = PROC_RUNNABLE,
+        .wait_queue = NULL,
+        .children_exit = LIST_HEAD_INIT(thread->children_exit),
+        .kernel_thread = true,
+        .leader = thread,
+        .name = "kthread"
+    };
+
+    fpu_init_process(thread);
+    proc_add(thread, proc_least_loaded_cpu());
+
+    return thread;
+}
+
+/* Sets up a new thread's kernel stack as if it had already been interrupted,
+ * so that switching to it returns to userspace at `eip` with `user_stack`.
+ * Returns the stack pointer to save for `proc_switch_process`.
+ */
+static uintptr_t proc_setup_kernel_stack(uintptr_t kernel_stack, uintptr_t user_stack,
+        uintptr_t eip) {
+    // We use this label as the return address from `proc_switch_process`
+    uint32_t* jmp = &proc_user_entry;
+    uintptr_t esp;
+
+    asm volatile (
+        // Save our stack in %ebx
+        "mov %%esp, %%ebx\n"
+
+        // Temporarily use the new thread's kernel stack
+        "mov %[kstack], %%eax\n"
+        "mov %%eax, %%esp\n"
+
+        // Stuff popped by `iret`
+        "push $0x23\n"         // user ds selector
+        "mov %[ustack], %%eax\n"
+        "push %%eax\n"         // %esp
+        "push $0x202\n"        // %eflags with `IF` bit set
+        "push $0x1B\n"         // user cs selector
+        "push %[eip]\n"        // %eip
+        // Push error code, interrupt number
+        "sub $8, %%esp\n"
+        // `pusha` equivalent
+        "sub $32, %%esp\n"
+        // push data segment registers
+        "mov $0x20, %%eax\n"
+        "push %%eax\n"
+        "push %%eax\n"
+        "push %%eax\n"
+        "push %%eax\n"
+
+        // Push proc_switch_process's `ret` %eip
+        "mov %[jmp], %%eax\n"
+        "push %%eax\n"
+        // Push garbage %ebx, %esi, %edi, %ebp
+        "push $1\n"
+        "push $2\n"
+        "push $3\n"
+        "push $4\n"
+
+        // Save the new thread's %esp in %eax
+        "mov %%esp, %%eax\n"
+        // Restore our stack
+        "mov %%ebx, %%esp\n"
+        // Update the new thread's %esp
+        "mov %%eax, %[esp]\n"
+        : [esp] "=r" (esp)
+        : [kstack] "r" (kernel_stack),
+          [ustack] "r" (user_stack),
+          [eip] "r" (eip),
+          [jmp] "r" (jmp)
+        : "%eax", "%ebx"
+    );
+
+    return esp;
 }
 
 /* Creates a process running the code specified at `code` in raw instructions
@@ -48,7 +370,7 @@ process_t* proc_run_code(uint8_t* code, uint32_t size, char** argv) {
     uint32_t num_code_pages = divide_up(size, 0x1000);
     uint32_t num_stack_pages = PROC_STACK_PAGES;
 
-    process_t* process = kmalloc(sizeof(process_t));
+    process_t* process = kamalloc(sizeof(process_t), 16);
     uintptr_t kernel_stack = (uintptr_t) aligned_alloc(4, 0x1000 * PROC_KERNEL_STACK_PAGES);
     uintptr_t pd_phys = pmm_alloc_page();
 
@@ -128,241 +450,1088 @@ process_t* proc_run_code(uint8_t* code, uint32_t size, char** argv) {
         .saved_kernel_stack = kernel_stack + PROC_KERNEL_STACK_PAGES * 0x1000 - 4,
         .initial_user_stack = (uintptr_t) ustack_int,
         .mem_len = 0,
-        .sleep_ticks = 0,
-        .filetable = LIST_HEAD_INIT(process->filetable),
-        .cwd = strdup("/")
+        .wakeup_tick = 0,
+        .cwd = strdup("/"),
+        .state = PROC_RUNNABLE,
+        .wait_queue = NULL,
+        .children_exit = LIST_HEAD_INIT(process->children_exit),
+        .leader = process
     };
 
-    // We use this label as the return address from `proc_switch_process`
-    uint32_t* jmp = &irq_handler_end;
+    proc_update_peak_rss(process);
+    fpu_init_process(process);
+
+    process->saved_kernel_stack = proc_setup_kernel_stack(process->kernel_stack,
+        process->initial_user_stack, 0x00001000);
+
+    proc_add(process, proc_least_loaded_cpu());
+
+    return process;
+}
+
+/* Charges the TSC cycles elapsed since the last call to the current process,
+ * as time spent in userspace or in the kernel.
+ */
+static void proc_charge(bool user) {
+    proc_cpu_t* cpu = this_cpu;
+
+    if (!has_tsc || !cpu->current) {
+        return;
+    }
+
+    uint64_t now = cpu_rdtsc();
+
+    if (user) {
+        cpu->current->user_cycles += now - cpu->last_charge;
+    } else {
+        cpu->current->kernel_cycles += now - cpu->last_charge;
+    }
+
+    cpu->last_charge = now;
+}
+
+/* Charges the ticks elapsed since the last call to the idle task if it was
+ * running, and updates the CPU usage, averaged over all CPUs, about once per
+ * second.
+ */
+static void proc_account() {
+    proc_cpu_t* cpu = this_cpu;
+    uint32_t now = timer_get_tick();
+
+    if (cpu->current == cpu->idle) {
+        cpu->idle_ticks += now - cpu->last_account_tick;
+    }
+
+    cpu->last_account_tick = now;
+
+    if (now - usage_mark_tick >= TIMER_FREQ) {
+        uint32_t idle_ticks = proc_get_idle_ticks();
+        uint32_t idle = idle_ticks - usage_mark_idle;
+        uint32_t available = (now - usage_mark_tick) * cpu_count;
+
+        cpu_usage = idle < available ? 100 - (idle * 100) / available : 0;
+        usage_mark_tick = now;
+        usage_mark_idle = idle_ticks;
+    }
+}
+
+/* Programs the next timer interrupt for when the scheduler or a sleeping
+ * process needs it, so that no tick is taken for nothing in tickless mode.
+ * Userspace may be reading the kernel info page, which must then be kept
+ * reasonably fresh, see `kinfo_update`.
+ */
+static void proc_set_next_tick(process_t* next) {
+    sched_t* scheduler = this_cpu->scheduler;
+    uint32_t now = timer_get_tick();
+    uint32_t delay = 0;
+
+    if (next != this_cpu->idle) {
+        delay = scheduler->sched_slice ? scheduler->sched_slice(scheduler) : 1;
+
+        if (!next->kernel_thread && (!delay || delay > KINFO_MAX_AGE)) {
+            delay = KINFO_MAX_AGE;
+        }
+    }
+
+    if (!list_empty(&sleepers)) {
+        process_t* first = list_first_entry(&sleepers, process_t);
+        int32_t until_wakeup = first->wakeup_tick - now;
+        uint32_t wakeup_delay = until_wakeup > 0 ? until_wakeup : 1;
+
+        if (!delay || wakeup_delay < delay) {
+            delay = wakeup_delay;
+        }
+    }
+
+    timer_set_next_tick(delay);
+}
+
+/* Returns whether the threads of the process led by `leader` may move to
+ * another CPU: none of them may be running, or have its FPU state loaded.
+ */
+static bool proc_can_migrate(process_t* leader) {
+    process_t* p;
+
+    list_for_each_entry(p, &processes) {
+        if (p->leader != leader) {
+            continue;
+        }
+
+        if (p == cpus[p->cpu].current || fpu_is_loaded(p)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Moves the threads of the process led by `leader` to the scheduler of `cpu`.
+ * Threads are kept together, as they share an address space: its TLB entries
+ * are only ever invalidated on the CPU they run on, and `proc_exit` frees the
+ * kernel stacks of the other threads, which mustn't be running elsewhere.
+ */
+static void proc_migrate(process_t* leader, uint32_t cpu) {
+    sched_t* to = cpus[cpu].scheduler;
+    process_t* p;
+
+    list_for_each_entry(p, &processes) {
+        if (p->leader != leader) {
+            continue;
+        }
+
+        sched_t* from = cpus[p->cpu].scheduler;
+
+        from->sched_exit(from, p);
+        p->cpu = cpu;
+        to->sched_add(to, p);
+
+        if (p->state != PROC_RUNNABLE) {
+            to->sched_block(to, p);
+        }
+    }
+}
+
+/* Called when the calling CPU has nothing to run: takes a process from the
+ * CPU with the most runnable processes, if it has more than the one it runs.
+ * Returns whether a process was taken.
+ */
+static bool proc_steal() {
+    uint32_t self = smp_current_cpu();
+    uint32_t victim = SMP_NO_CPU;
+    uint32_t victim_load = 1;
+
+    for (uint32_t cpu = 0; cpu < CPU_MAX; cpu++) {
+        if (cpu == self || !cpus[cpu].scheduler) {
+            continue;
+        }
+
+        uint32_t load = proc_cpu_load(cpu);
+
+        if (load > victim_load) {
+            victim = cpu;
+            victim_load = load;
+        }
+    }
+
+    if (victim == SMP_NO_CPU) {
+        return false;
+    }
+
+    process_t* p;
+
+    list_for_each_entry(p, &processes) {
+        if (p->cpu == victim && p->state == PROC_RUNNABLE && proc_can_migrate(p->leader)) {
+            proc_migrate(p->leader, self);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Runs the scheduler of the calling CPU. The scheduler may then decide to
+ * elect a new process, or not. If it has nothing to run, the CPU tries to take
+ * work from another one, and runs its idle task otherwise.
+ */
+void proc_schedule() {
+    proc_cpu_t* cpu = this_cpu;
+    process_t* prev = cpu->current;
+
+    cpu->need_resched = false;
+    proc_account();
+    kinfo_update();
+
+    process_t* next = cpu->scheduler->sched_next(cpu->scheduler);
+
+    if (!next && proc_steal()) {
+        next = cpu->scheduler->sched_next(cpu->scheduler);
+    }
+
+    if (!next) {
+        next = cpu->idle;
+    }
+
+    proc_set_next_tick(next);
+
+    if (next != prev) {
+        trace_event(TRACE_SWITCH, prev->pid, next->pid);
+        proc_charge(false);
+
+        // Yielding counts as involuntary: we could have kept running
+        if (prev->state == PROC_RUNNABLE) {
+            prev->involuntary_switches++;
+        } else {
+            prev->voluntary_switches++;
+        }
+
+        fpu_switch(prev, next);
+        cpu->current = next;
+
+        /* The next process will release the kernel lock as many times as it
+         * took it. We may be resumed on another CPU, so `cpu` isn't valid
+         * past this point. */
+        uint32_t depth = smp_kernel_lock_depth();
+
+        proc_switch_process(prev, next);
+        smp_kernel_lock_set_depth(depth);
+    }
+}
+
+/* Gives up the CPU to the next runnable process, if there's one.
+ */
+void proc_yield() {
+    sched_t* scheduler = this_cpu->scheduler;
+
+    if (scheduler->sched_yield) {
+        scheduler->sched_yield(scheduler);
+    }
+
+    proc_schedule();
+}
+
+/* Removes the first occurrence of `data` from `list`, if any.
+ */
+static void proc_list_remove(list_t* list, void* data) {
+    list_t* iter;
+    void* d;
+
+    list_for_each(iter, d, list) {
+        if (d == data) {
+            list_del(iter);
+            return;
+        }
+    }
+}
+
+/* Makes a sleeping or blocked process runnable again, taking it out of the
+ * sleep queue and of the wait queue it may be on.
+ */
+void proc_unblock(process_t* p) {
+    if (p->state == PROC_RUNNABLE) {
+        return;
+    }
+
+    if (p->wait_queue) {
+        proc_list_remove(p->wait_queue, p);
+        p->wait_queue = NULL;
+    }
+
+    proc_list_remove(&sleepers, p);
+    p->state = PROC_RUNNABLE;
+    cpus[p->cpu].scheduler->sched_wake(cpus[p->cpu].scheduler, p);
+
+    // Its CPU may be idle, or running a process told it could run indefinitely
+    if (p->cpu != smp_current_cpu()) {
+        smp_send_resched(p->cpu);
+        return;
+    }
+
+    if (p->kernel_thread) {
+        this_cpu->need_resched = true;
+    }
+
+    // The current process may have been told it could run indefinitely
+    timer_set_next_tick(1);
+}
+
+/* Makes runnable again the processes whose sleep is over.
+ */
+static void proc_wake_sleepers() {
+    uint32_t now = timer_get_tick();
+
+    while (!list_empty(&sleepers)) {
+        process_t* p = list_first_entry(&sleepers, process_t);
+
+        if ((int32_t) (p->wakeup_tick - now) > 0) {
+            break;
+        }
+
+        proc_unblock(p);
+    }
+}
+
+/* Returns whether the interrupted context `regs` may be switched away from:
+ * userspace and the idle loop may, kernel threads run until they block.
+ */
+static bool proc_can_preempt(registers_t* regs) {
+    return (regs->cs & 0x3) || current_process == this_cpu->idle;
+}
+
+/* Called on clock ticks, wakes up sleeping processes and calls the scheduler.
+ */
+void proc_timer_callback(registers_t* regs) {
+    proc_wake_sleepers();
+
+    if (proc_can_preempt(regs)) {
+        proc_schedule();
+    }
+}
+
+/* Called when returning from an interrupt: if it woke up a kernel thread, e.g.
+ * by queuing work, let it run now rather than on the next tick.
+ */
+void proc_preempt(registers_t* regs) {
+    // Interrupts can happen during boot, before there's anything to switch from
+    if (this_cpu->need_resched && current_process && proc_can_preempt(regs)) {
+        proc_schedule();
+    }
+}
+
+/* Called when another CPU asks this one to run its scheduler, e.g. because it
+ * woke up one of its processes, see `smp_send_resched`.
+ */
+void proc_resched(registers_t* regs) {
+    this_cpu->need_resched = true;
+    proc_preempt(regs);
+}
+
+/* Called when entering the kernel from an interrupt, exception or system
+ * call: if it interrupted userspace, the time since we last returned there
+ * was spent in userspace.
+ */
+void proc_account_entry(registers_t* regs) {
+    if (regs->cs & 0x3) {
+        proc_charge(true);
+    }
+}
+
+/* Called when leaving the kernel, with the frame we're about to return to,
+ * which may belong to another process than the one that entered.
+ */
+void proc_account_exit(registers_t* regs) {
+    if (regs->cs & 0x3) {
+        proc_charge(false);
+    }
+}
+
+void proc_account_page_fault() {
+    if (current_process) {
+        current_process->page_faults++;
+    }
+}
+
+/* Make the first jump to usermode.
+ * A special function is needed as our first kernel stack isn't setup to return
+ * to any interrupt handler; we have to `iret` ourselves.
+ */
+void proc_enter_usermode() {
+    CLI(); // Interrupts will be reenabled by `iret`
+
+    proc_cpu_t* cpu = this_cpu;
+    sched_t* scheduler = cpu->scheduler;
+    process_t* proc = scheduler->sched_get_current(scheduler);
+
+    /* Kernel threads can't be entered this way; they'll run once something
+     * schedules them. Each process is looked at once at most. */
+    for (uint32_t i = list_count(&processes); i && proc; i--) {
+        if (!proc->kernel_thread) {
+            break;
+        }
+
+        proc = scheduler->sched_next(scheduler);
+    }
+
+    if (!proc || proc->kernel_thread) {
+        printke("no process to run");
+        abort();
+    }
+
+    cpu->current = proc;
+
+    timer_register_callback(&proc_timer_callback);
+    proc_set_next_tick(proc);
+    gdt_set_kernel_stack(proc->kernel_stack);
+    paging_switch_directory(proc->directory);
+    cpu->last_charge = has_tsc ? cpu_rdtsc() : 0;
+
+    // Let the other CPUs in, see `init_smp`
+    smp_kernel_unlock();
 
-    // Setup the process's kernel stack as if it had already been interrupted
     asm volatile (
-        // Save our stack in %ebx
-        "mov %%esp, %%ebx\n"
+        "mov $0x23, %%eax\n"
+        "mov %%eax, %%ds\n"
+        "mov %%eax, %%es\n"
+        "mov %%eax, %%fs\n"
+        "mov %%eax, %%gs\n"
+        "push %%eax\n"       // %ss
+        "mov %[ustack], %%eax\n"
+        "push %%eax\n"       // %esp
+        "push $0x202\n"      // %eflags with IF set
+        "push $0x1B\n"       // %cs
+        "push $0x00001000\n" // %eip
+        "iret\n"
+        :: [ustack] "r" (proc->initial_user_stack)
+        : "%eax");
+}
+
+/* Grows the fd table of `proc` so that it can hold at least `count` fds.
+ * Returns false if that'd exceed `PROC_MAX_FD`.
+ */
+static bool proc_grow_fds(process_t* proc, uint32_t count) {
+    if (count <= proc->fd_count) {
+        return true;
+    }
+
+    if (count > PROC_MAX_FD) {
+        return false;
+    }
+
+    uint32_t new_count = proc->fd_count ? proc->fd_count : PROC_INITIAL_FDS;
+
+    while (new_count < count) {
+        new_count *= 2;
+    }
+
+    new_count = min(new_count, PROC_MAX_FD);
+
+    uint32_t old_words = proc->fd_count / 32;
+    uint32_t new_words = new_count / 32;
+
+    proc->fds = realloc(proc->fds, new_count * sizeof(ft_entry_t*));
+    proc->fd_bitmap = realloc(proc->fd_bitmap, new_words * sizeof(uint32_t));
+
+    memset(&proc->fds[proc->fd_count], 0,
+        (new_count - proc->fd_count) * sizeof(ft_entry_t*));
+    memset(&proc->fd_bitmap[old_words], 0,
+        (new_words - old_words) * sizeof(uint32_t));
+
+    proc->fd_count = new_count;
+
+    return true;
+}
+
+/* Returns the filetable entry associated with fd, if any.
+ */
+ft_entry_t* proc_fd_to_entry(uint32_t fd) {
+    if (fd >= current_process->leader->fd_count) {
+        return NULL;
+    }
+
+    return current_process->leader->fds[fd];
+}
+
+/* Removes a file descriptor from the given process's table.
+ * Frees the open file description entirely if unused.
+ */
+static void proc_release_fd_of(process_t* proc, uint32_t fd) {
+    if (fd >= proc->fd_count || !proc->fds[fd]) {
+        return;
+    }
+
+    ft_entry_t* ent = proc->fds[fd];
+
+    proc->fds[fd] = NULL;
+    proc->fd_bitmap[fd / 32] &= ~(1 << (fd % 32));
+    ent->refcount--;
+
+    if (ent->refcount == 0) {
+        /* TODO: this is out of place... the fs doesn't care about
+         * "open" or "close" */
+        fs_close(ent->inode);
+        kfree(ent);
+    }
+}
+
+/* Installs `entry` as `fd` in the given process's table.
+ * Increments the refcount of the passed entry.
+ */
+static bool proc_install_fd(process_t* proc, uint32_t fd, ft_entry_t* entry) {
+    if (!proc_grow_fds(proc, fd + 1)) {
+        return false;
+    }
+
+    proc_release_fd_of(proc, fd);
+
+    entry->refcount++;
+    proc->fds[fd] = entry;
+    proc->fd_bitmap[fd / 32] |= 1 << (fd % 32);
+
+    return true;
+}
+
+/* Removes a file descriptor from the current process's table.
+ */
+void proc_release_fd(uint32_t fd) {
+    proc_release_fd_of(current_process->leader, fd);
+}
+
+/* Adds or replaces a file descriptor for the current process.
+ * Increments the refcount of the passed entry.
+ */
+void proc_add_fd(uint32_t fd, ft_entry_t* entry) {
+    proc_install_fd(current_process->leader, fd, entry);
+}
+
+/* Returns the lowest unused fd of the current process, growing its table if
+ * needed, or 0 if the process has `PROC_MAX_FD` files open already.
+ */
+uint32_t proc_next_fd() {
+    uint32_t* bitmap = current_process->leader->fd_bitmap;
+    uint32_t words = current_process->leader->fd_count / 32;
+
+    for (uint32_t i = PROC_FIRST_FD / 32; i < words; i++) {
+        uint32_t used = bitmap[i];
+
+        // Don't hand out the reserved fds
+        if (i == 0) {
+            used |= (1 << PROC_FIRST_FD) - 1;
+        }
+
+        if (used != 0xFFFFFFFF) {
+            return i * 32 + __builtin_ctz(~used);
+        }
+    }
+
+    uint32_t fd = max(current_process->leader->fd_count, PROC_FIRST_FD);
+
+    return proc_grow_fds(current_process->leader, fd + 1) ? fd : 0;
+}
+
+/* Frees the kernel stack of `proc`, which mustn't be running on it.
+ */
+static void proc_free_kernel_stack(process_t* proc) {
+    if (proc->kernel_stack) {
+        kfree((void*) (proc->kernel_stack - 0x1000 * PROC_KERNEL_STACK_PAGES + 4));
+        proc->kernel_stack = 0;
+    }
+}
+
+/* Frees what remains of a process after it has exited. Exiting processes
+ * keep running on their kernel stack until they switch away for good, so it's
+ * only freed here.
+ */
+static void proc_free(process_t* proc) {
+    proc_free_kernel_stack(proc);
+    kfree(proc->cwd);
+    kfree(proc);
+}
+
+/* Frees the zombies that no process will ever wait for, except the current
+ * process, which may be one of them. Exited threads are left to `proc_exit`.
+ */
+static void proc_reap_orphans() {
+    list_t* iter;
+    process_t* p;
+
+    list_for_each(iter, p, &zombies) {
+        if (p->leader == p && !p->parent_pid && p != current_process) {
+            iter = iter->prev;
+            list_del(iter->next);
+            proc_free(p);
+        }
+    }
+}
+
+/* Gets rid of the threads of `proc` other than the current one, e.g. because
+ * the process is exiting, whatever they were doing. The main thread's
+ * structure is kept, as it holds what threads share.
+ */
+static void proc_kill_threads(process_t* proc) {
+    list_t* iter;
+    process_t* p;
+
+    list_for_each(iter, p, &processes) {
+        if (p->leader != proc || p == current_process) {
+            continue;
+        }
+
+        iter = iter->prev;
+        list_del(iter->next);
+
+        if (p->wait_queue) {
+            proc_list_remove(p->wait_queue, p);
+        }
+
+        proc_list_remove(&sleepers, p);
+        cpus[p->cpu].scheduler->sched_exit(cpus[p->cpu].scheduler, p);
+        fpu_release(p);
+        proc_free_kernel_stack(p);
+
+        if (p != proc) {
+            proc_free(p);
+        }
+    }
+
+    // Threads that exited but weren't joined
+    list_for_each(iter, p, &zombies) {
+        if (p->leader == proc && p != proc) {
+            iter = iter->prev;
+            list_del(iter->next);
+            proc_free(p);
+        }
+    }
+}
+
+/* Terminates the current process with the given exit status, along with all
+ * of its threads. Implements the `exit` system call.
+ * The process then stays around as a zombie until its parent collects its
+ * exit status with `proc_waitpid`.
+ */
+void proc_exit(int32_t status) {
+    process_t* proc = current_process->leader;
+
+    proc_kill_threads(proc);
+
+    // Free allocated pages: code, heap, stack, page directory
+    directory_entry_t* pd = (directory_entry_t*) 0xFFFFF000;
+
+    for (uint32_t i = 0; i < 768; i++) {
+        if (!(pd[i] & PAGE_PRESENT)) {
+            continue;
+        }
+
+        uintptr_t page = pd[i] & PAGE_FRAME;
+        pmm_free_page(page);
+    }
+
+    uintptr_t pd_page = pd[1023] & PAGE_FRAME;
+    pmm_free_page(pd_page);
+
+    // Close file descriptors and free the table
+    for (uint32_t fd = 0; fd < proc->fd_count; fd++) {
+        proc_release_fd(fd);
+    }
+
+    kfree(proc->fds);
+    kfree(proc->fd_bitmap);
+
+    // Don't leave windows nobody will ever close on screen
+    wm_close_windows_of(proc->pid);
+
+    proc_list_remove(&processes, current_process);
+
+    // Our children are orphans now, and our zombie children won't be waited for
+    process_t* p;
+
+    list_for_each_entry(p, &processes) {
+        if (p->parent_pid == proc->pid) {
+            p->parent_pid = 0;
+        }
+    }
+
+    list_for_each_entry(p, &zombies) {
+        if (p->parent_pid == proc->pid) {
+            p->parent_pid = 0;
+        }
+    }
+
+    proc_reap_orphans();
+
+    // Become a zombie, and let our parent know
+    process_t* parent = proc_get_process(proc->parent_pid);
+
+    if (!parent) {
+        proc->parent_pid = 0;
+    }
+
+    proc->state = PROC_ZOMBIE;
+    proc->exit_status = status;
+    list_add(&zombies, proc);
+
+    if (parent) {
+        proc_wake_all(&parent->children_exit);
+    }
+
+    /* If another thread called `exit`, it's freed as an orphan once we've
+     * switched away from it */
+    if (current_process != proc) {
+        current_process->leader = current_process;
+        current_process->parent_pid = 0;
+        current_process->state = PROC_ZOMBIE;
+        list_add(&zombies, current_process);
+    }
+
+    fpu_release(current_process);
+
+    // This last line is actually safe, and necessary
+    this_cpu->scheduler->sched_exit(this_cpu->scheduler, current_process);
+    proc_schedule();
+}
 
-        // Temporarily use the new process's kernel stack
-        "mov %[kstack], %%eax\n"
-        "mov %%eax, %%esp\n"
+/* Creates a thread in the current process, starting in userspace at `entry`
+ * with its stack pointer set to `stack`, which the caller has set up.
+ * Returns the new thread's id, which is a pid of its own.
+ */
+int32_t proc_thread_create(uintptr_t entry, uintptr_t stack, uintptr_t tls) {
+    process_t* proc = current_process->leader;
+    process_t* thread = kamalloc(sizeof(process_t), 16);
+    uintptr_t kernel_stack = (uintptr_t) aligned_alloc(4, 0x1000 * PROC_KERNEL_STACK_PAGES);
 
-        // Stuff popped by `iret`
-        "push $0x23\n"         // user ds selector
-        "mov %[ustack], %%eax\n"
-        "push %%eax\n"         // %esp
-        "push $0x202\n"        // %eflags with `IF` bit set
-        "push $0x1B\n"         // user cs selector
-        "push $0x00001000\n"   // %eip
-        // Push error code, interrupt number
-        "sub $8, %%esp\n"
-        // `pusha` equivalent
-        "sub $32, %%esp\n"
-        // push data segment registers
-        "mov $0x20, %%eax\n"
-        "push %%eax\n"
-        "push %%eax\n"
-        "push %%eax\n"
-        "push %%eax\n"
+    *thread = (process_t) {
+        .pid = next_pid++,
+        .directory = proc->directory,
+        .kernel_stack = kernel_stack + PROC_KERNEL_STACK_PAGES * 0x1000 - 4,
+        .initial_user_stack = stack,
+        .state = PROC_RUNNABLE,
+        .wait_queue = NULL,
+        .traced = current_process->traced,
+        .trace_children = current_process->trace_children,
+        .children_exit = LIST_HEAD_INIT(thread->children_exit),
+        .leader = proc,
+        .tls = tls
+    };
 
-        // Push proc_switch_process's `ret` %eip
-        "mov %[jmp], %%eax\n"
-        "push %%eax\n"
-        // Push garbage %ebx, %esi, %edi, %ebp
-        "push $1\n"
-        "push $2\n"
-        "push $3\n"
-        "push $4\n"
+    memcpy(thread->name, proc->name, PROCSTAT_NAME_MAX);
 
-        // Save the new process's %esp in %eax
-        "mov %%esp, %%eax\n"
-        // Restore our stack
-        "mov %%ebx, %%esp\n"
-        // Update the new process's %esp
-        "mov %%eax, %[esp]\n"
-        : [esp] "=r" (process->saved_kernel_stack)
-        : [kstack] "r" (process->kernel_stack),
-          [ustack] "r" (process->initial_user_stack),
-          [jmp] "r" (jmp)
-        : "%eax", "%ebx"
-    );
+    thread->saved_kernel_stack = proc_setup_kernel_stack(thread->kernel_stack,
+        stack, entry);
 
-    scheduler->sched_add(scheduler, process);
+    fpu_init_process(thread);
 
-    return process;
+    // Threads of a process stay on the same CPU, see `proc_migrate`
+    proc_add(thread, current_process->cpu);
+
+    return thread->pid;
 }
 
-/* Runs the scheduler. The scheduler may then decide to elect a new process, or
- * not.
+/* Terminates the current thread, to be collected by `proc_thread_join`.
+ * The main thread can't exit on its own: this exits the whole process.
  */
-void proc_schedule() {
-    process_t* next = scheduler->sched_next(scheduler);
+void proc_thread_exit(int32_t status) {
+    process_t* proc = current_process->leader;
 
-    if (next == current_process) {
+    if (current_process == proc) {
+        proc_exit(status);
         return;
     }
 
-    fpu_switch(current_process, next);
-    proc_switch_process(next);
-}
+    // Our kernel stack is freed along with the zombie, see `proc_free`
+    proc_list_remove(&processes, current_process);
 
-/* Called on clock ticks, calls the scheduler.
- */
-void proc_timer_callback(registers_t* regs) {
-    UNUSED(regs);
+    current_process->state = PROC_ZOMBIE;
+    current_process->exit_status = status;
+    list_add(&zombies, current_process);
 
+    // Joining threads wait with the process's waiting parents
+    proc_wake_all(&proc->children_exit);
+
+    fpu_release(current_process);
+    this_cpu->scheduler->sched_exit(this_cpu->scheduler, current_process);
     proc_schedule();
 }
 
-/* Make the first jump to usermode.
- * A special function is needed as our first kernel stack isn't setup to return
- * to any interrupt handler; we have to `iret` ourselves.
+/* Waits for the thread `tid` of the current process to exit, and collects its
+ * exit status in `status` if it isn't NULL.
+ * Returns `tid`, or -1 if there's no such thread other than the main and the
+ * current ones.
  */
-void proc_enter_usermode() {
-    CLI(); // Interrupts will be reenabled by `iret`
+int32_t proc_thread_join(uint32_t tid, int32_t* status) {
+    process_t* proc = current_process->leader;
 
-    current_process = scheduler->sched_get_current(scheduler);
+    while (true) {
+        list_t* iter;
+        process_t* p;
+        bool found = false;
 
-    if (!current_process) {
-        printke("no process to run");
-        abort();
-    }
+        list_for_each(iter, p, &zombies) {
+            if (p->leader == proc && p != proc && p->pid == tid) {
+                if (status) {
+                    *status = p->exit_status;
+                }
 
-    timer_register_callback(&proc_timer_callback);
-    gdt_set_kernel_stack(current_process->kernel_stack);
-    paging_switch_directory(current_process->directory);
+                list_del(iter);
+                proc_free(p);
 
-    asm volatile (
-        "mov $0x23, %%eax\n"
-        "mov %%eax, %%ds\n"
-        "mov %%eax, %%es\n"
-        "mov %%eax, %%fs\n"
-        "mov %%eax, %%gs\n"
-        "push %%eax\n"       // %ss
-        "mov %[ustack], %%eax\n"
-        "push %%eax\n"       // %esp
-        "push $0x202\n"      // %eflags with IF set
-        "push $0x1B\n"       // %cs
-        "push $0x00001000\n" // %eip
-        "iret\n"
-        :: [ustack] "r" (current_process->initial_user_stack)
-        : "%eax");
-}
+                return tid;
+            }
+        }
 
-/* Returns the filetable entry associated with fd, if any.
- */
-ft_entry_t* proc_fd_to_entry(uint32_t fd) {
-    ft_entry_t* ent;
+        list_for_each_entry(p, &processes) {
+            if (p->leader == proc && p != proc && p != current_process && p->pid == tid) {
+                found = true;
+                break;
+            }
+        }
 
-    list_for_each_entry(ent, &current_process->filetable) {
-        if (ent->fd == fd) {
-            return ent;
+        if (!found) {
+            return -1;
         }
+
+        proc_wait(&proc->children_exit, 0);
     }
+}
 
-    return NULL;
+/* Returns the id of the current thread: the pid, for the main thread.
+ */
+uint32_t proc_get_current_tid() {
+    return current_process ? current_process->pid : 0;
 }
 
-/* Removes a file descriptor from the current process's list.
- * Frees it entirely if unused.
+/* Sets the current thread's TLS pointer, see `proc_get_tls`.
  */
-void proc_release_fd(uint32_t fd) {
-    ft_entry_t* ent;
-    list_t* iter;
+void proc_set_tls(uintptr_t tls) {
+    current_process->tls = tls;
+}
 
-    list_for_each(iter, ent, &current_process->filetable) {
-        if (ent->fd == fd) {
-            list_del(iter);
-            ent->refcount--;
+/* Returns the current thread's TLS pointer, an address the kernel keeps for
+ * the thread library, usually pointing to thread-local storage.
+ */
+uintptr_t proc_get_tls() {
+    return current_process->tls;
+}
+
+/* Waits for the child `pid` to exit, or for any child if `pid` is -1, and
+ * collects its exit status in `status` if it isn't NULL.
+ * Returns the pid of the child, -1 if there is no such child, or 0 if it
+ * hasn't exited and `WAIT_NOHANG` is passed in `flags`.
+ * Any thread of the parent may collect the child.
+ */
+int32_t proc_waitpid(int32_t pid, int32_t* status, uint32_t flags) {
+    uint32_t self = current_process->leader->pid;
 
-            if (ent->refcount == 0) {
-                /* TODO: this is out of place... the fs doesn't care about
-                 * "open" or "close" */
-                fs_close(ent->inode);
-                free(ent);
+    while (true) {
+        list_t* iter;
+        process_t* p;
+        bool has_child = false;
+
+        list_for_each(iter, p, &zombies) {
+            if (p->parent_pid == self && (pid == -1 || p->pid == (uint32_t) pid)) {
+                int32_t ret = p->pid;
+
+                if (status) {
+                    *status = p->exit_status;
+                }
+
+                list_del(iter);
+                proc_free(p);
+
+                return ret;
             }
+        }
 
-            break;
+        list_for_each_entry(p, &processes) {
+            if (p->parent_pid == self && (pid == -1 || p->pid == (uint32_t) pid)) {
+                has_child = true;
+                break;
+            }
+        }
+
+        if (!has_child) {
+            return -1;
+        }
+
+        if (flags & WAIT_NOHANG) {
+            return 0;
         }
+
+        proc_wait(&current_process->leader->children_exit, 0);
     }
 }
 
-/* Adds or replaces a file descriptor for the current process.
- * Increments the refcount of the passed entry.
+/* Returns the number of ticks spent idling since boot, summed over CPUs.
  */
-void proc_add_fd(ft_entry_t* entry) {
-    ft_entry_t* ent;
-    list_t* iter;
+uint32_t proc_get_idle_ticks() {
+    uint32_t ticks = 0;
 
-    list_for_each(iter, ent, &current_process->filetable) {
-        if (ent->fd == entry->fd) {
-            proc_release_fd(ent->fd);
-            break;
-        }
+    for (uint32_t cpu = 0; cpu < CPU_MAX; cpu++) {
+        ticks += cpus[cpu].idle_ticks;
     }
 
-    entry->refcount++;
-    list_add_front(&current_process->filetable, entry);
+    return ticks;
 }
 
-/* Returns a new and unused fd for the current process.
- * TODO: make it use the lowest fd available.
+/* Returns the percentage of the last second spent running processes, or the
+ * kernel on their behalf.
  */
-uint32_t proc_next_fd() {
-    static uint32_t avail = 3;
+uint32_t proc_get_cpu_usage() {
+    return cpu_usage;
+}
+
+/* Returns the number of bytes of memory mapped in the userspace part of a
+ * process's address space: code, heap and stack.
+ */
+static uint32_t proc_get_rss(process_t* proc) {
+    proc = proc->leader;
+
+    return 0x1000 * (proc->code_len + proc->stack_len) + align_to(proc->mem_len, 0x1000);
+}
 
-    return avail++;
+static void proc_update_peak_rss(process_t* proc) {
+    uint32_t rss = proc_get_rss(proc);
+
+    if (rss > proc->leader->peak_rss) {
+        proc->leader->peak_rss = rss;
+    }
+}
+
+static void proc_fill_stats(procstat_t* stat, process_t* p) {
+    static const char states[] = {
+        [PROC_RUNNABLE] = PROCSTAT_RUNNABLE,
+        [PROC_SLEEPING] = PROCSTAT_SLEEPING,
+        [PROC_BLOCKED] = PROCSTAT_BLOCKED,
+        [PROC_ZOMBIE] = PROCSTAT_ZOMBIE
+    };
+
+    *stat = (procstat_t) {
+        .pid = p->pid,
+        .tgid = p->leader->pid,
+        .parent_pid = p->leader->parent_pid,
+        .state = states[p->state],
+        .user_cycles = p->user_cycles,
+        .kernel_cycles = p->kernel_cycles,
+        .voluntary_switches = p->voluntary_switches,
+        .involuntary_switches = p->involuntary_switches,
+        .page_faults = p->page_faults,
+        .rss = p->state == PROC_ZOMBIE ? 0 : proc_get_rss(p),
+        .peak_rss = p->leader->peak_rss
+    };
+
+    memcpy(stat->name, p->name, PROCSTAT_NAME_MAX);
+
+    for (uint32_t n = 0; n < SYS_MAX; n++) {
+        stat->syscalls += p->syscall_counts[n];
+    }
 }
 
-/* Terminates the currently executing process.
- * Implements the `exit` system call.
+/* Copies the accounting information of at most `count` threads, including the
+ * idle task of each CPU and zombies, to `buf`. Implements the `procstat`
+ * system call. Returns the total number of threads, which may be more than
+ * `count`.
  */
-void proc_exit() {
-    // Free allocated pages: code, heap, stack, page directory
-    directory_entry_t* pd = (directory_entry_t*) 0xFFFFF000;
+uint32_t proc_get_stats(procstat_t* buf, uint32_t count) {
+    list_t* lists[] = { &processes, &zombies };
+    uint32_t n = 0;
+    process_t* p;
 
-    for (uint32_t i = 0; i < 768; i++) {
-        if (!(pd[i] & PAGE_PRESENT)) {
+    for (uint32_t cpu = 0; cpu < CPU_MAX; cpu++) {
+        if (!cpus[cpu].idle) {
             continue;
         }
 
-        uintptr_t page = pd[i] & PAGE_FRAME;
-        pmm_free_page(page);
-    }
+        if (n < count) {
+            proc_fill_stats(&buf[n], cpus[cpu].idle);
+        }
 
-    uintptr_t pd_page = pd[1023] & PAGE_FRAME;
-    pmm_free_page(pd_page);
+        n++;
+    }
 
-    // Free the kernel stack
-    kfree((void*) (current_process->kernel_stack - 0x1000 * PROC_KERNEL_STACK_PAGES + 4));
+    for (uint32_t i = 0; i < sizeof(lists)/sizeof(lists[0]); i++) {
+        list_for_each_entry(p, lists[i]) {
+            if (n < count) {
+                proc_fill_stats(&buf[n], p);
+            }
 
-    // Free the file descriptor list
-    while (!list_empty(&current_process->filetable)) {
-        ft_entry_t* ent = list_first_entry(&current_process->filetable, ft_entry_t);
-        proc_release_fd(ent->fd);
+            n++;
+        }
     }
 
-    // This last line is actually safe, and necessary
-    scheduler->sched_exit(scheduler, current_process);
-    proc_schedule();
+    return n;
 }
 
 uint32_t proc_get_current_pid() {
     if (current_process) {
-        return current_process->pid;
+        return current_process->leader->pid;
     } else {
         return 0;
     }
 }
 
+/* Returns the process of the given pid, NULL if there's none.
+ */
+process_t* proc_get_process(uint32_t pid) {
+    process_t* p;
+
+    list_for_each_entry(p, &processes) {
+        if (p->pid == pid) {
+            return p;
+        }
+    }
+
+    return NULL;
+}
+
+/* Asks the scheduler to favor a process for a while, if it supports it.
+ */
+void proc_boost(uint32_t pid) {
+    process_t* p = proc_get_process(pid);
+
+    if (!p) {
+        return;
+    }
+
+    sched_t* scheduler = cpus[p->cpu].scheduler;
+
+    if (scheduler->sched_boost) {
+        uint32_t eflags = irq_save(); // The WM thread calls this unmasked
+
+        scheduler->sched_boost(scheduler, p);
+        irq_restore(eflags);
+    }
+}
+
 /* Returns a dynamically allocated copy of the current process's current working
  * directory.
  */
 char* proc_get_cwd() {
-    return strdup(current_process->cwd);
+    return strdup(current_process->leader->cwd);
+}
+
+/* Adds the current process to the sleep queue, to be woken up in `ticks`
+ * ticks.
+ */
+static void proc_add_sleeper(uint32_t ticks) {
+    current_process->wakeup_tick = timer_get_tick() + ticks;
+
+    // Insert it before the first process to wake up after it
+    list_t* iter;
+    process_t* p;
+
+    list_for_each(iter, p, &sleepers) {
+        if ((int32_t) (p->wakeup_tick - current_process->wakeup_tick) > 0) {
+            break;
+        }
+    }
+
+    list_add_front(iter->prev, current_process);
 }
 
+/* Puts the current process to sleep for at least `ms` milliseconds. It is
+ * taken out of the scheduler until then, and costs nothing in the meantime.
+ */
 void proc_sleep(uint32_t ms) {
-    current_process->sleep_ticks = (uint32_t) ((ms*TIMER_FREQ)/1000.0);
+    uint32_t ticks = divide_up(ms * TIMER_FREQ, 1000);
+
+    if (!ticks) {
+        proc_yield();
+        return;
+    }
+
+    proc_add_sleeper(ticks);
+    current_process->state = PROC_SLEEPING;
+    this_cpu->scheduler->sched_block(this_cpu->scheduler, current_process);
+    proc_schedule();
+}
+
+/* Blocks the current process until `proc_wake_all` is called on `queue`, or
+ * until `timeout` milliseconds have passed if `timeout` isn't zero.
+ */
+void proc_wait(wait_queue_t* queue, uint32_t timeout) {
+    uint32_t ticks = divide_up(timeout * TIMER_FREQ, 1000);
+    uint32_t eflags = irq_save(); // Kernel threads run with interrupts enabled
+
+    list_add(queue, current_process);
+    current_process->wait_queue = queue;
+    current_process->state = PROC_BLOCKED;
+
+    if (ticks) {
+        proc_add_sleeper(ticks);
+    }
+
+    this_cpu->scheduler->sched_block(this_cpu->scheduler, current_process);
     proc_schedule();
+    irq_restore(eflags);
+}
+
+/* Makes every process blocked on `queue` runnable again.
+ */
+void proc_wake_all(wait_queue_t* queue) {
+    uint32_t eflags = irq_save();
+
+    while (!list_empty(queue)) {
+        proc_unblock(list_first_entry(queue, process_t));
+    }
+
+    irq_restore(eflags);
 }
 
 /* Extends the program's writeable memory by `size` bytes.
@@ -370,7 +1539,8 @@ void proc_sleep(uint32_t ms) {
  * details.
  */
 void* proc_sbrk(intptr_t size) {
-    uintptr_t end = 0x1000 + 0x1000*current_process->code_len + current_process->mem_len;
+    process_t* proc = current_process->leader; // Threads share the heap
+    uintptr_t end = 0x1000 + 0x1000*proc->code_len + proc->mem_len;
 
     // Bytes available in the last allocated page
     int32_t remaining_bytes = (end % 0x1000) ? (0x1000 - (end % 0x1000)) : 0;
@@ -386,7 +1556,7 @@ void* proc_sbrk(intptr_t size) {
             }
         }
     } else if (size < 0) {
-        if (end + size < 0x1000*current_process->code_len) {
+        if (end + size < 0x1000*proc->code_len) {
             return (void*) -1; // Can't deallocate the code
         }
 
@@ -406,11 +1576,15 @@ void* proc_sbrk(intptr_t size) {
         }
     }
 
-    current_process->mem_len += size;
+    proc->mem_len += size;
+    proc_update_peak_rss(proc);
 
     return (void*) end;
 }
 
+/* Starts the executable at `path` as a child of the current process.
+ * Returns the new process's pid, or -1 on failure.
+ */
 int32_t proc_exec(const char* path, char** argv) {
     /* Read the executable */
     inode_t* in = fs_open(path, O_RDONLY);
@@ -425,56 +1599,68 @@ int32_t proc_exec(const char* path, char** argv) {
     if (read == in->size && in->size) {
         process_t* p = proc_run_code(data, in->size, argv);
 
-        // Clone file descriptors
+        /* The child is ours to wait for, and shares our open file descriptions
+         * under the same fds */
         if (proc_get_current_pid()) {
-            ft_entry_t* ent;
+            process_t* parent = current_process->leader;
+
+            p->parent_pid = parent->pid;
+            p->traced = current_process->traced || current_process->trace_children;
 
-            list_for_each_entry(ent, &current_process->filetable) {
-                ent->refcount++;
-                list_add_front(&p->filetable, ent);
+            proc_grow_fds(p, parent->fd_count);
+
+            for (uint32_t fd = 0; fd < parent->fd_count; fd++) {
+                if (parent->fds[fd]) {
+                    proc_install_fd(p, fd, parent->fds[fd]);
+                }
             }
         }
-    } else {
-        printke("exec failed while reading the executable");
-        return -1;
+
+        const char* name = strrchr(path, '/');
+        strncpy(p->name, name ? name + 1 : path, PROCSTAT_NAME_MAX - 1);
+
+        return p->pid;
     }
 
-    return 0;
+    printke("exec failed while reading the executable");
+
+    return -1;
 }
 
 uint32_t proc_open(const char* path, uint32_t flags) {
     inode_t* in = fs_open((char*) path, flags); // TODO
 
-    if (in) {
-        ft_entry_t* ent = kmalloc(sizeof(ft_entry_t));
-
-        ent->fd = proc_next_fd();
-        ent->inode = in;
-        ent->mode = 0; // TODO: make use of this or delete it?
-        ent->offset = 0;
-        ent->size = in->size;
-        ent->index = 0;
-        ent->refcount = 1;
+    if (!in) {
+        return 0;
+    }
 
-        list_add_front(&current_process->filetable, ent);
+    uint32_t fd = proc_next_fd();
 
-        return ent->fd;
+    if (!fd) {
+        fs_close(in);
+        return 0;
     }
 
-    return 0;
+    ft_entry_t* ent = kmalloc(sizeof(ft_entry_t));
+
+    ent->inode = in;
+    ent->mode = 0; // TODO: make use of this or delete it?
+    ent->offset = 0;
+    ent->size = in->size;
+    ent->index = 0;
+    ent->refcount = 0;
+
+    proc_add_fd(fd, ent);
+
+    return fd;
 }
 
+/* Closes a file descriptor of the current process. The underlying file is
+ * only closed once no process refers to it anymore.
+ */
 void proc_close(uint32_t fd) {
-    list_t* iter;
-    ft_entry_t* ent;
-    list_for_each(iter, ent, &current_process->filetable) {
-        if (ent->fd == fd) {
-            // TODO: At some point, we'll want to have a fs-layer writelock
-            fs_close(ent->inode);
-            list_del(iter);
-            return;
-        }
-    }
+    // TODO: At some point, we'll want to have a fs-layer writelock
+    proc_release_fd(fd);
 }
 
 uint32_t proc_read(uint32_t fd, uint8_t* buf, uint32_t size) {
@@ -553,18 +1739,92 @@ int32_t proc_ftell(uint32_t fd) {
     return ent->offset;
 }
 
+/* Reads into each buffer of `iov` in turn, from the fd's offset, stopping at
+ * the first short read. Returns the total number of bytes read, or -1 if the
+ * fd is invalid.
+ */
+int32_t proc_readv(uint32_t fd, const iovec_t* iov, uint32_t count) {
+    ft_entry_t* ent = proc_fd_to_entry(fd);
+
+    if (!ent || count > FS_IOV_MAX) {
+        return -1;
+    }
+
+    uint32_t total = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t read = fs_read(ent->inode, ent->offset, iov[i].iov_base, iov[i].iov_len);
+        ent->offset += read;
+        total += read;
+
+        if (read < iov[i].iov_len) {
+            break;
+        }
+    }
+
+    return total;
+}
+
+/* Writes each buffer of `iov` in turn, stopping at the first short write.
+ * Returns the total number of bytes written, or -1 if the fd is invalid.
+ */
+int32_t proc_writev(uint32_t fd, const iovec_t* iov, uint32_t count) {
+    ft_entry_t* ent = proc_fd_to_entry(fd);
+
+    if (!ent || count > FS_IOV_MAX) {
+        return -1;
+    }
+
+    uint32_t total = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t written = fs_write(ent->inode, iov[i].iov_base, iov[i].iov_len);
+        ent->offset += written;
+        total += written;
+
+        if (written < iov[i].iov_len) {
+            break;
+        }
+    }
+
+    return total;
+}
+
+/* Reads from `offset` in the file, leaving the fd's offset untouched.
+ */
+int32_t proc_pread(uint32_t fd, uint8_t* buf, uint32_t size, uint32_t offset) {
+    ft_entry_t* ent = proc_fd_to_entry(fd);
+
+    if (!ent) {
+        return -1;
+    }
+
+    return fs_read(ent->inode, offset, buf, size);
+}
+
+/* Writes at `offset` in the file, leaving the fd's offset untouched.
+ */
+int32_t proc_pwrite(uint32_t fd, uint8_t* buf, uint32_t size, uint32_t offset) {
+    ft_entry_t* ent = proc_fd_to_entry(fd);
+
+    if (!ent) {
+        return -1;
+    }
+
+    return fs_pwrite(ent->inode, offset, buf, size);
+}
+
 int32_t proc_chdir(const char* path) {
-    // TODO: replace existence check with `stat` to validate path
     char* npath = fs_normalize_path(path);
     inode_t* in = fs_open(npath, O_RDONLY);
 
-    if (in) {
+    if (!in || in->type != DENT_DIRECTORY) {
         kfree(npath);
         return -1;
     }
 
-    kfree(current_process->cwd);
-    current_process->cwd = npath;
+    kfree(current_process->leader->cwd);
+    current_process->leader->cwd = npath;
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include <kernel/prof.h>
+#include <kernel/proc.h>
+#include <kernel/stacktrace.h>
+#include <kernel/timer.h>
+#include <kernel/sys.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* A sampling profiler: a timer interrupt records where it interrupted the
+ * current thread, see `timer_start_sampling`.
+ * Interrupts are disabled in system calls and interrupt handlers, so kernel
+ * samples land in kernel threads (the WM, work queues) and the idle loop;
+ * time spent in system calls shows up as the instruction that follows them
+ * in userspace.
+ * The sampling interrupt is only delivered to the boot processor, so there's
+ * a single buffer rather than one per CPU.
+ *
+ * `prof_dump` prints one line per sample to the serial port:
+ *     prof <pid> <u|k> <eip> <kernel symbol or ->
+ * which folds into a flamegraph on the host with e.g.
+ *     grep '^prof ' serial.log | awk '{print $2";"($3=="k"?$5:$4)" 1"}' | flamegraph.pl
+ */
+
+static prof_sample_t* samples = NULL;
+static uint32_t sample_count = 0;
+static uint32_t dropped = 0;
+static bool running = false;
+
+static void prof_sample(registers_t* regs) {
+    if (sample_count == PROF_MAX_SAMPLES) {
+        dropped++;
+        return;
+    }
+
+    samples[sample_count++] = (prof_sample_t) {
+        .eip = regs->eip,
+        .pid = current_process ? current_process->pid : 0,
+        .flags = (regs->cs & 0x3) ? PROF_SAMPLE_USER : 0
+    };
+}
+
+/* Discards previous samples and starts sampling at about `freq` Hz, or at
+ * `PROF_DEFAULT_FREQ` if it's 0.
+ * Returns the frequency actually used.
+ */
+uint32_t prof_start(uint32_t freq) {
+    if (!samples) {
+        samples = kmalloc(PROF_MAX_SAMPLES * sizeof(prof_sample_t));
+    }
+
+    sample_count = 0;
+    dropped = 0;
+    running = true;
+
+    return timer_start_sampling(&prof_sample, freq ? freq : PROF_DEFAULT_FREQ);
+}
+
+/* Stops sampling, and returns the number of samples taken.
+ */
+uint32_t prof_stop() {
+    if (running) {
+        timer_stop_sampling();
+        running = false;
+    }
+
+    if (dropped) {
+        printk("%d samples dropped, the buffer was full", dropped);
+    }
+
+    return sample_count;
+}
+
+/* Copies at most `count` samples to `buf`, starting from sample number
+ * `offset`. Returns the number of samples copied.
+ */
+uint32_t prof_read(prof_sample_t* buf, uint32_t count, uint32_t offset) {
+    if (offset >= sample_count) {
+        return 0;
+    }
+
+    if (count > sample_count - offset) {
+        count = sample_count - offset;
+    }
+
+    memcpy(buf, &samples[offset], count * sizeof(prof_sample_t));
+
+    return count;
+}
+
+/* Prints the samples to the serial port, see the format above.
+ */
+void prof_dump() {
+    char sym[64];
+
+    printf("prof begin %d\n", sample_count);
+
+    for (uint32_t i = 0; i < sample_count; i++) {
+        prof_sample_t* s = &samples[i];
+        bool user = s->flags & PROF_SAMPLE_USER;
+
+        if (user || !stacktrace_lookup(s->eip, sym, sizeof(sym))) {
+            strcpy(sym, "-");
+        }
+
+        printf("prof %d %c 0x%X %s\n", s->pid, user ? 'u' : 'k', s->eip, sym);
+    }
+
+    printf("prof end\n");
+}
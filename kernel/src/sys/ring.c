@@ -0,0 +1,100 @@
+#include <kernel/ring.h>
+#include <kernel/proc.h>
+#include <kernel/paging.h>
+#include <kernel/syscall.h>
+#include <kernel/sys.h>
+
+#include <kernel/uapi/uapi_syscall.h>
+#include <kernel/uapi/uapi_wm.h>
+
+#include <stdbool.h>
+
+/* System calls that may be queued in a ring, see `ring_sqe_t`.
+ */
+static bool ring_allowed[SYSCALL_NUM] = {
+    [SYS_WM] = true,
+    [SYS_OPEN] = true,
+    [SYS_CLOSE] = true,
+    [SYS_READ] = true,
+    [SYS_WRITE] = true,
+    [SYS_FSEEK] = true,
+    [SYS_FTELL] = true,
+    [SYS_STAT] = true,
+    [SYS_CLOCK] = true,
+    [SYS_GETPID] = true,
+    [SYS_READV] = true,
+    [SYS_WRITEV] = true,
+    [SYS_PREAD] = true,
+    [SYS_PWRITE] = true
+};
+
+/* Makes `ring` the current process's ring, after resetting it. Returns -1 if
+ * it isn't in userspace memory.
+ */
+int32_t ring_setup(ring_t* ring) {
+    if (ring && (uintptr_t) ring > KERNEL_BASE_VIRT - sizeof(ring_t)) {
+        return -1;
+    }
+
+    if (ring) {
+        ring->sq_head = ring->sq_tail = 0;
+        ring->cq_head = ring->cq_tail = 0;
+    }
+
+    current_process->leader->ring = ring;
+
+    return 0;
+}
+
+/* Runs a submission as the corresponding system call would, and returns its
+ * return value.
+ */
+static int32_t ring_execute(const ring_sqe_t* sqe) {
+    if (sqe->syscall >= SYS_MAX || !ring_allowed[sqe->syscall]) {
+        return -1;
+    }
+
+    // Waiting for events or opening windows have no business here
+    if (sqe->syscall == SYS_WM && sqe->args[0] != WM_CMD_RENDER) {
+        return -1;
+    }
+
+    registers_t regs = {
+        .eax = sqe->syscall,
+        .ebx = sqe->args[0],
+        .ecx = sqe->args[1],
+        .edx = sqe->args[2],
+        .esi = sqe->args[3]
+    };
+
+    syscall_handler(&regs);
+
+    return regs.eax;
+}
+
+/* Runs the pending submissions of the current process, in order, as long as
+ * there's room for their completions.
+ * Returns the number of submissions consumed, or -1 if there's no ring.
+ */
+int32_t ring_enter() {
+    ring_t* ring = current_process->leader->ring;
+    uint32_t done = 0;
+
+    if (!ring) {
+        return -1;
+    }
+
+    while (ring->sq_head != ring->sq_tail && ring->cq_tail - ring->cq_head < RING_SIZE) {
+        ring_sqe_t sqe = ring->sq[ring->sq_head % RING_SIZE];
+        ring->sq_head++;
+
+        ring_cqe_t* cqe = &ring->cq[ring->cq_tail % RING_SIZE];
+        cqe->user_data = sqe.user_data;
+        cqe->result = ring_execute(&sqe);
+        ring->cq_tail++;
+
+        done++;
+    }
+
+    return done;
+}
@@ -0,0 +1,395 @@
+#include <kernel/sched_mlfq.h>
+#include <kernel/timer.h>
+#include <kernel/sys.h>
+
+#include <stdlib.h>
+
+/* Number of priority levels, level 0 being the most important one */
+#define MLFQ_LEVELS 4
+
+/* Every process is moved back to the top level this often, in ticks, so that
+ * CPU-bound processes can't be starved by a stream of interactive ones */
+#define MLFQ_BOOST_PERIOD (2 * TIMER_FREQ)
+
+/* Time slice granted to processes of each level, in ticks */
+static const uint32_t mlfq_quantum[MLFQ_LEVELS] = { 1, 2, 4, 8 };
+
+/* Wraps a `process_t*` with its position in the feedback queue.
+ * `used` counts the ticks spent running at the current level: a process is
+ * demoted once it has consumed its level's quantum, whether or not it slept
+ * in between, so that sleeping right before the end of a slice doesn't keep
+ * a process on top.
+ */
+typedef struct _mlfq_node_t {
+    process_t* process;
+    uint32_t level;
+    uint32_t used;
+    struct _mlfq_node_t* next;
+} mlfq_node_t;
+
+typedef struct {
+    mlfq_node_t* head;
+    mlfq_node_t* tail;
+} mlfq_queue_t;
+
+/* A multi-level feedback queue: one FIFO per priority level. The running
+ * process isn't part of any queue, it is put back at the tail of its level's
+ * queue when preempted. Blocked processes are kept aside in `blocked` so that
+ * they keep their level when woken up.
+ * As with `sched_robin_t`, the `sched_t` member comes first so that pointers
+ * to this struct can be cast to `sched_t*`.
+ */
+typedef struct {
+    sched_t sched;
+    mlfq_node_t* current;
+    mlfq_queue_t queues[MLFQ_LEVELS];
+    mlfq_queue_t blocked;
+    uint32_t last_tick;
+    uint32_t last_boost;
+    bool yielded; // Whether the current process gave up the CPU, see `sched_yield`
+} sched_mlfq_t;
+
+static void mlfq_push(mlfq_queue_t* queue, mlfq_node_t* node) {
+    node->next = NULL;
+
+    if (queue->tail) {
+        queue->tail->next = node;
+    } else {
+        queue->head = node;
+    }
+
+    queue->tail = node;
+}
+
+/* Unlinks `node` from `queue`, returns whether it was found.
+ */
+static bool mlfq_remove(mlfq_queue_t* queue, mlfq_node_t* node) {
+    mlfq_node_t* prev = NULL;
+    mlfq_node_t* n = queue->head;
+
+    while (n && n != node) {
+        prev = n;
+        n = n->next;
+    }
+
+    if (!n) {
+        return false;
+    }
+
+    if (prev) {
+        prev->next = n->next;
+    } else {
+        queue->head = n->next;
+    }
+
+    if (queue->tail == n) {
+        queue->tail = prev;
+    }
+
+    n->next = NULL;
+
+    return true;
+}
+
+/* Returns the node wrapping `process` in `queue`, NULL if it isn't there.
+ */
+static mlfq_node_t* mlfq_find_in(mlfq_queue_t* queue, process_t* process) {
+    for (mlfq_node_t* n = queue->head; n; n = n->next) {
+        if (n->process == process) {
+            return n;
+        }
+    }
+
+    return NULL;
+}
+
+/* Returns the node wrapping `process` if the scheduler knows it, NULL
+ * otherwise. `queue` is set to the queue containing it, NULL if it's the
+ * current process.
+ */
+static mlfq_node_t* mlfq_find(sched_mlfq_t* sc, process_t* process, mlfq_queue_t** queue) {
+    mlfq_node_t* n;
+    *queue = NULL;
+
+    if (sc->current && sc->current->process == process) {
+        return sc->current;
+    }
+
+    for (uint32_t i = 0; i < MLFQ_LEVELS; i++) {
+        if ((n = mlfq_find_in(&sc->queues[i], process))) {
+            *queue = &sc->queues[i];
+            return n;
+        }
+    }
+
+    if ((n = mlfq_find_in(&sc->blocked, process))) {
+        *queue = &sc->blocked;
+        return n;
+    }
+
+    return NULL;
+}
+
+/* Adds `elapsed` ticks to the time `node` ran at its level, and demotes it if
+ * it used up its quantum. Returns whether that happened.
+ */
+static bool mlfq_charge(mlfq_node_t* node, uint32_t elapsed) {
+    node->used += elapsed;
+
+    if (node->used < mlfq_quantum[node->level]) {
+        return false;
+    }
+
+    if (node->level < MLFQ_LEVELS - 1) {
+        node->level++;
+    }
+
+    node->used = 0;
+
+    return true;
+}
+
+/* Moves every process back to the top level, keeping their relative order.
+ * Blocked processes will be woken up at the top level too.
+ */
+static void mlfq_boost_all(sched_mlfq_t* sc) {
+    for (uint32_t i = 1; i < MLFQ_LEVELS; i++) {
+        mlfq_node_t* n;
+
+        while ((n = sc->queues[i].head)) {
+            mlfq_remove(&sc->queues[i], n);
+            n->level = 0;
+            n->used = 0;
+            mlfq_push(&sc->queues[0], n);
+        }
+    }
+
+    for (mlfq_node_t* n = sc->blocked.head; n; n = n->next) {
+        n->level = 0;
+        n->used = 0;
+    }
+
+    if (sc->current) {
+        sc->current->level = 0;
+        sc->current->used = 0;
+    }
+}
+
+/* Returns whether a process is waiting in a level strictly more important
+ * than `level`.
+ */
+static bool mlfq_waiting_above(sched_mlfq_t* sc, uint32_t level) {
+    for (uint32_t i = 0; i < level; i++) {
+        if (sc->queues[i].head) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Removes and returns the first process of the most important non-empty
+ * level, NULL if there's none.
+ */
+static mlfq_node_t* mlfq_pop(sched_mlfq_t* sc) {
+    for (uint32_t i = 0; i < MLFQ_LEVELS; i++) {
+        mlfq_node_t* n = sc->queues[i].head;
+
+        if (n) {
+            mlfq_remove(&sc->queues[i], n);
+            return n;
+        }
+    }
+
+    return NULL;
+}
+
+process_t* sched_mlfq_get_current(sched_t* sched) {
+    sched_mlfq_t* sc = (sched_mlfq_t*) sched;
+
+    if (sc->current) {
+        return sc->current->process;
+    }
+
+    return NULL;
+}
+
+/* New processes start at the top level. The first one added becomes the
+ * current process, as `sched_get_current` is called before `sched_next`.
+ */
+void sched_mlfq_add(sched_t* sched, process_t* new_process) {
+    sched_mlfq_t* sc = (sched_mlfq_t*) sched;
+    mlfq_node_t* new = kmalloc(sizeof(mlfq_node_t));
+
+    new->process = new_process;
+    new->level = 0;
+    new->used = 0;
+    new->next = NULL;
+
+    if (!sc->current) {
+        sc->current = new;
+    } else {
+        mlfq_push(&sc->queues[0], new);
+    }
+}
+
+/* Elects the next process.
+ * The current process keeps running until its quantum expires, it yields, or
+ * a process of a more important level becomes runnable.
+ */
+process_t* sched_mlfq_next(sched_t* sched) {
+    sched_mlfq_t* sc = (sched_mlfq_t*) sched;
+    mlfq_node_t* cur = sc->current;
+    uint32_t now = timer_get_tick();
+    uint32_t elapsed = now - sc->last_tick;
+
+    sc->last_tick = now;
+
+    if (now - sc->last_boost >= MLFQ_BOOST_PERIOD) {
+        mlfq_boost_all(sc);
+        sc->last_boost = now;
+    }
+
+    bool yielded = sc->yielded;
+    sc->yielded = false;
+
+    if (cur) {
+        bool expired = mlfq_charge(cur, elapsed);
+
+        if (!expired && !yielded && !mlfq_waiting_above(sc, cur->level)) {
+            return cur->process;
+        }
+
+        mlfq_push(&sc->queues[cur->level], cur);
+    }
+
+    sc->current = mlfq_pop(sc);
+
+    return sc->current ? sc->current->process : NULL;
+}
+
+/* The current process goes behind the other processes of its level, keeping
+ * what it used of its quantum.
+ */
+void sched_mlfq_yield(sched_t* sched) {
+    sched_mlfq_t* sc = (sched_mlfq_t*) sched;
+
+    sc->yielded = true;
+}
+
+/* The current process may run until the end of its quantum, or indefinitely
+ * if nothing else is runnable.
+ */
+uint32_t sched_mlfq_slice(sched_t* sched) {
+    sched_mlfq_t* sc = (sched_mlfq_t*) sched;
+    mlfq_node_t* cur = sc->current;
+
+    if (!cur || !mlfq_waiting_above(sc, MLFQ_LEVELS)) {
+        return 0;
+    }
+
+    return mlfq_quantum[cur->level] - cur->used;
+}
+
+/* Forgets about a process, whatever its state.
+ */
+void sched_mlfq_exit(sched_t* sched, process_t* process) {
+    sched_mlfq_t* sc = (sched_mlfq_t*) sched;
+    mlfq_queue_t* queue;
+    mlfq_node_t* node = mlfq_find(sc, process, &queue);
+
+    if (!node) {
+        return;
+    }
+
+    if (queue) {
+        mlfq_remove(queue, node);
+    } else {
+        sc->current = NULL;
+    }
+
+    kfree(node);
+}
+
+/* Moves a process to the blocked list, charging it for the time it ran if
+ * it's the current process.
+ */
+void sched_mlfq_block(sched_t* sched, process_t* process) {
+    sched_mlfq_t* sc = (sched_mlfq_t*) sched;
+    mlfq_queue_t* queue;
+    mlfq_node_t* node = mlfq_find(sc, process, &queue);
+
+    if (!node || queue == &sc->blocked) {
+        return;
+    }
+
+    if (queue) {
+        mlfq_remove(queue, node);
+    } else {
+        uint32_t now = timer_get_tick();
+
+        mlfq_charge(node, now - sc->last_tick);
+        sc->last_tick = now;
+        sc->current = NULL;
+    }
+
+    mlfq_push(&sc->blocked, node);
+}
+
+/* Puts a blocked process back at the tail of its level's queue.
+ */
+void sched_mlfq_wake(sched_t* sched, process_t* process) {
+    sched_mlfq_t* sc = (sched_mlfq_t*) sched;
+    mlfq_node_t* node = mlfq_find_in(&sc->blocked, process);
+
+    if (!node) {
+        return;
+    }
+
+    mlfq_remove(&sc->blocked, node);
+    mlfq_push(&sc->queues[node->level], node);
+}
+
+/* Moves a process to the top level with a fresh quantum, typically because it
+ * just received user input.
+ */
+void sched_mlfq_boost(sched_t* sched, process_t* process) {
+    sched_mlfq_t* sc = (sched_mlfq_t*) sched;
+    mlfq_queue_t* queue;
+    mlfq_node_t* node = mlfq_find(sc, process, &queue);
+
+    if (!node) {
+        return;
+    }
+
+    if (queue && queue != &sc->blocked && node->level != 0) {
+        mlfq_remove(queue, node);
+        mlfq_push(&sc->queues[0], node);
+    }
+
+    node->level = 0;
+    node->used = 0;
+}
+
+/* Allocates a multi-level feedback queue scheduler.
+ */
+sched_t* sched_mlfq() {
+    sched_mlfq_t* sched = zalloc(sizeof(sched_mlfq_t));
+
+    sched->sched = (sched_t) {
+        .sched_get_current = sched_mlfq_get_current,
+        .sched_add = sched_mlfq_add,
+        .sched_next = sched_mlfq_next,
+        .sched_exit = sched_mlfq_exit,
+        .sched_boost = sched_mlfq_boost,
+        .sched_block = sched_mlfq_block,
+        .sched_wake = sched_mlfq_wake,
+        .sched_slice = sched_mlfq_slice,
+        .sched_yield = sched_mlfq_yield
+    };
+
+    sched->last_tick = timer_get_tick();
+    sched->last_boost = sched->last_tick;
+
+    return (sched_t*) sched;
+}
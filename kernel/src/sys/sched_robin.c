@@ -46,62 +46,58 @@ void sched_robin_add(sched_t* sched, process_t* new_process) {
     }
 }
 
+/* Elects the process following the current one in the ring. Sleeping
+ * processes aren't part of the ring, see `proc_sleep`.
+ */
 process_t* sched_robin_next(sched_t* sched) {
     sched_robin_t* sc = (sched_robin_t*) sched;
-    proc_node_t* p = sc->processes;
 
-    // Avoid switching to a sleeping process if possible
-    do {
-        if (p->next->process->sleep_ticks > 0) {
-            p->next->process->sleep_ticks--;
-        } else {
-            // We don't need to switch process
-            if (p->next == sc->processes) {
-                return sc->processes->process;
-            }
-
-            // We don't need to modify the process queue
-            if (p->next == sc->processes->next) {
-                break;
-            }
-
-            // We insert the next process between the current one and the one
-            // previously scheduled to be switched to.
-            proc_node_t* previous = p;
-            proc_node_t* next_proc = p->next;
-            proc_node_t* moved = sc->processes->next;
-
-            previous->next = next_proc->next;
-            next_proc->next = moved;
-            sc->processes->next = next_proc;
-
-            break;
-        }
-
-        p = p->next;
-    } while (p != sc->processes);
+    if (!sc->processes) {
+        return NULL;
+    }
 
     sc->processes = sc->processes->next;
 
     return sc->processes->process;
 }
 
+/* Processes are switched every tick, unless there's only one.
+ */
+uint32_t sched_robin_slice(sched_t* sched) {
+    sched_robin_t* sc = (sched_robin_t*) sched;
+
+    if (!sc->processes || sc->processes->next == sc->processes) {
+        return 0;
+    }
+
+    return 1;
+}
+
 void sched_robin_exit(sched_t* sched, process_t* process) {
     sched_robin_t* sc = (sched_robin_t*) sched;
     proc_node_t* p = sc->processes;
 
-    if (sc->processes == sc->processes->next) {
-        abort();
+    if (!p) {
+        return;
     }
 
     while (p->next->process != process) {
         p = p->next;
+
+        // Not in the ring
+        if (p == sc->processes) {
+            return;
+        }
     }
 
     proc_node_t* to_remove = p->next;
-    p->next = p->next->next;
 
-    sc->processes = p;
+    if (to_remove == p) {
+        sc->processes = NULL;
+    } else {
+        p->next = p->next->next;
+        sc->processes = p;
+    }
 
     kfree(to_remove);
 }
@@ -115,7 +111,10 @@ sched_t* sched_robin() {
         .sched_get_current = sched_robin_get_current,
         .sched_add = sched_robin_add,
         .sched_next = sched_robin_next,
-        .sched_exit = sched_robin_exit
+        .sched_exit = sched_robin_exit,
+        .sched_block = sched_robin_exit,
+        .sched_wake = sched_robin_add,
+        .sched_slice = sched_robin_slice
     };
 
     sched->processes = NULL;
@@ -3,10 +3,21 @@
 #include <kernel/fs.h>
 #include <kernel/proc.h>
 #include <kernel/timer.h>
+#include <kernel/clock.h>
+#include <kernel/cpu.h>
 #include <kernel/fb.h>
+#include <kernel/fpu.h>
 #include <kernel/wm.h>
 #include <kernel/serial.h>
 #include <kernel/pipe.h>
+#include <kernel/ring.h>
+#include <kernel/smp.h>
+#include <kernel/systrace.h>
+#include <kernel/futex.h>
+#include <kernel/prof.h>
+#include <kernel/trace.h>
+#include <kernel/stacktrace.h>
+#include <kernel/boottime.h>
 #include <kernel/sys.h> // for UNUSED macro
 
 #include <stdio.h>
@@ -14,8 +25,7 @@
 #include <string.h>
 
 #include <kernel/uapi/uapi_syscall.h>
-
-static void syscall_handler(registers_t* regs);
+#include <kernel/uapi/uapi_thread.h>
 
 static void syscall_yield(registers_t* regs);
 static void syscall_exit(registers_t* regs);
@@ -39,11 +49,70 @@ static void syscall_unlink(registers_t* regs);
 static void syscall_rename(registers_t* regs);
 static void syscall_maketty(registers_t* regs);
 static void syscall_stat(registers_t* regs);
+static void syscall_clock(registers_t* regs);
+static void syscall_getpid(registers_t* regs);
+static void syscall_readv(registers_t* regs);
+static void syscall_writev(registers_t* regs);
+static void syscall_pread(registers_t* regs);
+static void syscall_pwrite(registers_t* regs);
+static void syscall_ring(registers_t* regs);
+static void syscall_systrace(registers_t* regs);
+static void syscall_waitpid(registers_t* regs);
+static void syscall_thread(registers_t* regs);
+static void syscall_futex(registers_t* regs);
+static void syscall_procstat(registers_t* regs);
+static void syscall_prof(registers_t* regs);
+static void syscall_trace(registers_t* regs);
+
+extern void syscall_sysenter_entry();
 
 handler_t syscall_handlers[SYSCALL_NUM] = { 0 };
 
+/* System calls that neither use the FPU nor switch processes, which lets the
+ * `sysenter` path skip saving and restoring the FPU state around them.
+ */
+static bool syscall_fpu_free[SYSCALL_NUM] = {
+    [SYS_SBRK] = true,
+    [SYS_FSEEK] = true,
+    [SYS_FTELL] = true,
+    [SYS_GETCWD] = true,
+    [SYS_CLOCK] = true,
+    [SYS_GETPID] = true,
+    [SYS_PROCSTAT] = true
+};
+
+static bool sysenter_enabled = false;
+
+/* Sets up `sysenter` if the CPU supports it: the MSRs give the code segment
+ * to switch to, from which the stack segment is deduced, and the entry point.
+ * The stack is set on each process switch, see `gdt_set_kernel_stack`.
+ */
+static void init_sysenter() {
+    if (!cpu_has_feature_edx(CPUID_FEAT_EDX_SEP) ||
+            !cpu_has_feature_edx(CPUID_FEAT_EDX_MSR)) {
+        return;
+    }
+
+    sysenter_enabled = true;
+    syscall_init_ap();
+}
+
+/* Points the calling CPU's `sysenter` MSRs to our entry point. Each CPU has
+ * its own, application processors set them up when they start.
+ */
+void syscall_init_ap() {
+    if (!sysenter_enabled) {
+        return;
+    }
+
+    cpu_wrmsr(MSR_SYSENTER_CS, 0x08);
+    cpu_wrmsr(MSR_SYSENTER_ESP, 0);
+    cpu_wrmsr(MSR_SYSENTER_EIP, (uintptr_t) syscall_sysenter_entry);
+}
+
 void init_syscall() {
     isr_register_handler(48, syscall_handler);
+    init_sysenter();
 
     syscall_handlers[SYS_YIELD] = syscall_yield;
     syscall_handlers[SYS_EXIT] = syscall_exit;
@@ -67,21 +136,71 @@ void init_syscall() {
     syscall_handlers[SYS_RENAME] = syscall_rename;
     syscall_handlers[SYS_MAKETTY] = syscall_maketty;
     syscall_handlers[SYS_STAT] = syscall_stat;
+    syscall_handlers[SYS_CLOCK] = syscall_clock;
+    syscall_handlers[SYS_GETPID] = syscall_getpid;
+    syscall_handlers[SYS_READV] = syscall_readv;
+    syscall_handlers[SYS_WRITEV] = syscall_writev;
+    syscall_handlers[SYS_PREAD] = syscall_pread;
+    syscall_handlers[SYS_PWRITE] = syscall_pwrite;
+    syscall_handlers[SYS_RING] = syscall_ring;
+    syscall_handlers[SYS_SYSTRACE] = syscall_systrace;
+    syscall_handlers[SYS_WAITPID] = syscall_waitpid;
+    syscall_handlers[SYS_THREAD] = syscall_thread;
+    syscall_handlers[SYS_FUTEX] = syscall_futex;
+    syscall_handlers[SYS_PROCSTAT] = syscall_procstat;
+    syscall_handlers[SYS_PROF] = syscall_prof;
+    syscall_handlers[SYS_TRACE] = syscall_trace;
 }
 
-static void syscall_handler(registers_t* regs) {
+void syscall_handler(registers_t* regs) {
     if (regs->eax < SYS_MAX && syscall_handlers[regs->eax]) {
         handler_t handler = syscall_handlers[regs->eax];
+        systrace_call_t call;
+
+        systrace_begin(&call, regs);
+        trace_event(TRACE_SYSCALL_ENTRY, call.syscall, proc_get_current_tid());
         regs->eax = 0;
         handler(regs);
+        trace_event(TRACE_SYSCALL_EXIT, call.syscall, regs->eax);
+        systrace_end(&call, regs->eax);
     } else {
         printke("unknown syscall %d", regs->eax);
     }
 }
 
+/* Called from `syscall_sysenter_entry` with the same frame as `int $0x30`
+ * produces. Unlike `isr_handler`, only saves the FPU state when needed.
+ */
+void syscall_sysenter_handler(registers_t* regs) {
+    bool save_fpu = regs->eax >= SYSCALL_NUM || !syscall_fpu_free[regs->eax];
+
+    smp_kernel_lock();
+    proc_account_entry(regs);
+
+    if (save_fpu) {
+        fpu_kernel_enter();
+    }
+
+    syscall_handler(regs);
+    proc_account_exit(regs);
+
+    if (save_fpu) {
+        fpu_kernel_exit(regs);
+    }
+
+    smp_kernel_unlock();
+}
+
+/* Returns whether system calls may be made using `sysenter`.
+ */
+bool syscall_has_sysenter() {
+    return sysenter_enabled;
+}
+
 /* Convention:
  * - Syscall number in eax,
  * - Arguments shall be passed in this order: ebx, ecx, edx, esi,
+ *   or ebx, edi, ebp, esi through `sysenter`, see `sysenter.S`,
  * - If more are needed, pack them into a struct pointer,
  * - Values shall be returned first in eax, then in user-provided pointers.
  */
@@ -89,14 +208,13 @@ static void syscall_handler(registers_t* regs) {
 static void syscall_yield(registers_t* regs) {
     UNUSED(regs);
 
-    proc_schedule();
+    proc_yield();
 }
 
 static void syscall_exit(registers_t* regs) {
-    UNUSED(regs);
+    int32_t status = regs->ebx;
 
-    // TODO: exit status?
-    proc_exit();
+    proc_exit(status);
 }
 
 static void syscall_sleep(registers_t* regs) {
@@ -139,6 +257,10 @@ static void syscall_wm(registers_t* regs) {
                 wm_param_event_t* param = (wm_param_event_t*) regs->ecx;
                 wm_get_event(param->win_id, param->event);
             } break;
+        case WM_CMD_WAIT_EVENT: {
+                wm_param_event_t* param = (wm_param_event_t*) regs->ecx;
+                wm_wait_event(param->win_id, param->event, param->timeout);
+            } break;
         case WM_CMD_IS_HOVERED: {
             /* TODO: replace by a combination of cursor events and their
              * handling in the titlebar widget.
@@ -180,6 +302,15 @@ static void syscall_info(registers_t* regs) {
     if (request & SYS_INFO_LOG && info->kernel_log) {
         strcpy(info->kernel_log, serial_get_log());
     }
+
+    if (request & SYS_INFO_CPU) {
+        info->cpu_usage = proc_get_cpu_usage();
+        info->idle_time = proc_get_idle_ticks() * (1.0f / TIMER_FREQ);
+    }
+
+    if (request & SYS_INFO_BOOT && info->boot_phases) {
+        info->boot_phase_count = boottime_get_phases(info->boot_phases);
+    }
 }
 
 static void syscall_exec(registers_t* regs) {
@@ -189,6 +320,122 @@ static void syscall_exec(registers_t* regs) {
     regs->eax = proc_exec(name, args);
 }
 
+static void syscall_waitpid(registers_t* regs) {
+    int32_t pid = regs->ebx;
+    int32_t* status = (int32_t*) regs->ecx;
+    uint32_t flags = regs->edx;
+
+    regs->eax = proc_waitpid(pid, status, flags);
+}
+
+/* Fills an array of `procstat_t`, see `proc_get_stats`:
+ *     uint32_t syscall_procstat(procstat_t* buf, uint32_t count);
+ */
+static void syscall_procstat(registers_t* regs) {
+    procstat_t* buf = (procstat_t*) regs->ebx;
+    uint32_t count = regs->ecx;
+
+    regs->eax = proc_get_stats(buf, count);
+}
+
+/* Controls the sampling profiler, see `uapi_prof.h`.
+ */
+static void syscall_prof(registers_t* regs) {
+    uint32_t cmd = regs->ebx;
+
+    switch (cmd) {
+        case PROF_CMD_START:
+            regs->eax = prof_start(regs->ecx);
+            break;
+        case PROF_CMD_STOP:
+            regs->eax = prof_stop();
+            break;
+        case PROF_CMD_READ:
+            regs->eax = prof_read((prof_sample_t*) regs->ecx, regs->edx, regs->esi);
+            break;
+        case PROF_CMD_DUMP:
+            prof_dump();
+            break;
+        case PROF_CMD_SYMBOL:
+            regs->eax = stacktrace_lookup(regs->ecx, (char*) regs->edx, regs->esi);
+            break;
+        default:
+            regs->eax = -1;
+            break;
+    }
+}
+
+/* Controls event tracing, see `uapi_trace.h`.
+ */
+static void syscall_trace(registers_t* regs) {
+    uint32_t cmd = regs->ebx;
+
+    switch (cmd) {
+        case TRACE_CMD_START:
+            trace_start();
+            break;
+        case TRACE_CMD_STOP:
+            regs->eax = trace_stop();
+            break;
+        case TRACE_CMD_DUMP:
+            trace_dump();
+            break;
+        default:
+            regs->eax = -1;
+            break;
+    }
+}
+
+/* Blocks on or wakes up threads blocked on a word of memory, see
+ * `uapi_futex.h`.
+ */
+static void syscall_futex(registers_t* regs) {
+    uint32_t cmd = regs->ebx;
+    volatile uint32_t* addr = (volatile uint32_t*) regs->ecx;
+
+    switch (cmd) {
+        case FUTEX_CMD_WAIT:
+            regs->eax = futex_wait(addr, regs->edx, regs->esi);
+            break;
+        case FUTEX_CMD_WAKE:
+            regs->eax = futex_wake(addr, regs->edx);
+            break;
+        default:
+            regs->eax = -1;
+            break;
+    }
+}
+
+/* Manages the threads of the current process, see `uapi_thread.h`.
+ */
+static void syscall_thread(registers_t* regs) {
+    uint32_t cmd = regs->ebx;
+
+    switch (cmd) {
+        case THREAD_CMD_CREATE:
+            regs->eax = proc_thread_create(regs->ecx, regs->edx, regs->esi);
+            break;
+        case THREAD_CMD_EXIT:
+            proc_thread_exit(regs->ecx);
+            break;
+        case THREAD_CMD_JOIN:
+            regs->eax = proc_thread_join(regs->ecx, (int32_t*) regs->edx);
+            break;
+        case THREAD_CMD_SELF:
+            regs->eax = proc_get_current_tid();
+            break;
+        case THREAD_CMD_SET_TLS:
+            proc_set_tls(regs->ecx);
+            break;
+        case THREAD_CMD_GET_TLS:
+            regs->eax = proc_get_tls();
+            break;
+        default:
+            regs->eax = -1;
+            break;
+    }
+}
+
 static void syscall_open(registers_t* regs) {
     const char* path = (const char*) regs->ebx;
     uint32_t flags = regs->ecx;
@@ -225,6 +472,82 @@ static void syscall_write(registers_t* regs) {
     regs->eax = proc_write(fd, buf, size);
 }
 
+static void syscall_readv(registers_t* regs) {
+    uint32_t fd = regs->ebx;
+    const iovec_t* iov = (const iovec_t*) regs->ecx;
+    uint32_t count = regs->edx;
+
+    regs->eax = proc_readv(fd, iov, count);
+}
+
+static void syscall_writev(registers_t* regs) {
+    uint32_t fd = regs->ebx;
+    const iovec_t* iov = (const iovec_t*) regs->ecx;
+    uint32_t count = regs->edx;
+
+    regs->eax = proc_writev(fd, iov, count);
+}
+
+static void syscall_pread(registers_t* regs) {
+    uint32_t fd = regs->ebx;
+    uint8_t* buf = (uint8_t*) regs->ecx;
+    uint32_t size = regs->edx;
+    uint32_t offset = regs->esi;
+
+    regs->eax = proc_pread(fd, buf, size, offset);
+}
+
+static void syscall_pwrite(registers_t* regs) {
+    uint32_t fd = regs->ebx;
+    uint8_t* buf = (uint8_t*) regs->ecx;
+    uint32_t size = regs->edx;
+    uint32_t offset = regs->esi;
+
+    regs->eax = proc_pwrite(fd, buf, size, offset);
+}
+
+/* Sets up or processes the current process's submission ring, see
+ * `uapi_ring.h`.
+ */
+static void syscall_ring(registers_t* regs) {
+    uint32_t cmd = regs->ebx;
+
+    switch (cmd) {
+        case RING_CMD_SETUP:
+            regs->eax = ring_setup((ring_t*) regs->ecx);
+            break;
+        case RING_CMD_ENTER:
+            regs->eax = ring_enter();
+            break;
+        default:
+            regs->eax = -1;
+            break;
+    }
+}
+
+/* Gives access to system call statistics and to the trace buffer, see
+ * `uapi_systrace.h`.
+ */
+static void syscall_systrace(registers_t* regs) {
+    uint32_t cmd = regs->ebx;
+
+    switch (cmd) {
+        case SYSTRACE_CMD_STATS:
+            regs->eax = systrace_stats((systrace_stats_t*) regs->ecx, regs->edx);
+            break;
+        case SYSTRACE_CMD_FOLLOW:
+            systrace_follow(regs->ecx);
+            break;
+        case SYSTRACE_CMD_READ:
+            regs->eax = systrace_read((systrace_record_t*) regs->ecx, regs->edx,
+                (uint32_t*) regs->esi);
+            break;
+        default:
+            regs->eax = -1;
+            break;
+    }
+}
+
 static void syscall_mkdir(registers_t* regs) {
     const char* path = (const char*) regs->ebx;
     uint32_t mode = regs->ecx;
@@ -283,10 +606,9 @@ static void syscall_rename(registers_t* regs) {
 static void syscall_maketty(registers_t* regs) {
     ft_entry_t* entry = zalloc(sizeof(ft_entry_t));
 
-    entry->fd = FS_STDOUT_FILENO;
     entry->inode = pipe_new();
 
-    proc_add_fd(entry);
+    proc_add_fd(FS_STDOUT_FILENO, entry);
 
     regs->eax = 0;
 }
@@ -296,4 +618,23 @@ static void syscall_stat(registers_t* regs) {
     stat_t* buf = (stat_t*) regs->ecx;
 
     regs->eax = fs_stat(path, buf);
-}
\ No newline at end of file
+}
+
+/* Writes the time of the given clock in nanoseconds to a 64 bits integer.
+ * Returns -1 for unknown clocks.
+ */
+static void syscall_clock(registers_t* regs) {
+    uint32_t clock = regs->ebx;
+    uint64_t* ns = (uint64_t*) regs->ecx;
+
+    if (clock != CLOCK_MONOTONIC) {
+        regs->eax = -1;
+        return;
+    }
+
+    *ns = clock_get_ns();
+}
+
+static void syscall_getpid(registers_t* regs) {
+    regs->eax = proc_get_current_pid();
+}
@@ -0,0 +1,142 @@
+#include <kernel/systrace.h>
+#include <kernel/cpu.h>
+#include <kernel/sys.h>
+
+#include <string.h>
+
+/* Accounting of system calls: counts and time spent in each of them, per
+ * process and globally, along with latency histograms.
+ * Processes can also be traced: each of their system calls is then logged to
+ * a trace buffer, from which the `strace` module reads.
+ */
+
+static bool has_tsc = false;
+static systrace_stats_t stats;
+
+// The trace buffer, overwritten when full: readers may lose records
+static systrace_record_t records[SYSTRACE_BUF_SIZE];
+static uint32_t next_seq = 0;
+
+void init_systrace() {
+    has_tsc = cpu_has_feature_edx(CPUID_FEAT_EDX_TSC);
+}
+
+/* Returns the histogram bucket of a call that took `cycles` cycles.
+ */
+static uint32_t systrace_bucket(uint64_t cycles) {
+    if (cycles >> (SYSTRACE_BUCKETS + SYSTRACE_BUCKET_SHIFT - 1)) {
+        return SYSTRACE_BUCKETS - 1;
+    }
+
+    uint32_t c = (uint32_t) cycles >> SYSTRACE_BUCKET_SHIFT;
+
+    return c ? 32 - __builtin_clz(c) : 0;
+}
+
+static void systrace_log(const systrace_call_t* call, int32_t ret, uint32_t cycles) {
+    systrace_record_t* rec = &records[next_seq % SYSTRACE_BUF_SIZE];
+
+    *rec = (systrace_record_t) {
+        .seq = next_seq++,
+        .pid = call->proc->pid,
+        .syscall = call->syscall,
+        .ret = ret,
+        .cycles = cycles
+    };
+
+    memcpy(rec->args, call->args, sizeof(rec->args));
+}
+
+/* Called before a system call is dispatched. Calls that don't return, i.e.
+ * `exit`, are logged right away.
+ */
+void systrace_begin(systrace_call_t* call, const registers_t* regs) {
+    call->proc = current_process;
+    call->syscall = regs->eax;
+    call->args[0] = regs->ebx;
+    call->args[1] = regs->ecx;
+    call->args[2] = regs->edx;
+    call->args[3] = regs->esi;
+
+    if (call->syscall == SYS_EXIT) {
+        stats.count[SYS_EXIT]++;
+        call->proc->syscall_counts[SYS_EXIT]++;
+
+        if (call->proc->traced) {
+            systrace_log(call, 0, 0);
+        }
+    }
+
+    call->start = has_tsc ? cpu_rdtsc() : 0;
+}
+
+/* Called once the system call returns. Note that it may have switched
+ * processes in between, in which case the time spent in other processes is
+ * accounted too.
+ */
+void systrace_end(const systrace_call_t* call, int32_t ret) {
+    uint64_t cycles = has_tsc ? cpu_rdtsc() - call->start : 0;
+    uint32_t n = call->syscall;
+
+    stats.count[n]++;
+    stats.cycles[n] += cycles;
+    stats.histogram[n][systrace_bucket(cycles)]++;
+
+    call->proc->syscall_counts[n]++;
+    call->proc->syscall_cycles[n] += cycles;
+
+    if (call->proc->traced) {
+        systrace_log(call, ret, cycles > UINT32_MAX ? UINT32_MAX : cycles);
+    }
+}
+
+/* Sets whether the processes that the current process starts are traced.
+ */
+void systrace_follow(bool follow) {
+    current_process->trace_children = follow;
+}
+
+/* Copies the global statistics, or those of the process `pid` if it isn't 0,
+ * in which case there are no histograms.
+ * Returns -1 if there's no such process.
+ */
+int32_t systrace_stats(systrace_stats_t* buf, uint32_t pid) {
+    if (!pid) {
+        memcpy(buf, &stats, sizeof(systrace_stats_t));
+        return 0;
+    }
+
+    process_t* proc = proc_get_process(pid);
+
+    if (!proc) {
+        return -1;
+    }
+
+    memset(buf, 0, sizeof(systrace_stats_t));
+    memcpy(buf->count, proc->syscall_counts, sizeof(buf->count));
+    memcpy(buf->cycles, proc->syscall_cycles, sizeof(buf->cycles));
+
+    return 0;
+}
+
+/* Copies at most `count` trace records, starting from the one numbered
+ * `*cursor` or the oldest one still available, and updates the cursor to
+ * point after the last one copied.
+ * Returns the number of records copied.
+ */
+uint32_t systrace_read(systrace_record_t* buf, uint32_t count, uint32_t* cursor) {
+    uint32_t seq = *cursor;
+    uint32_t n = 0;
+
+    if (next_seq - seq > SYSTRACE_BUF_SIZE) {
+        seq = next_seq - SYSTRACE_BUF_SIZE;
+    }
+
+    while (n < count && seq != next_seq) {
+        buf[n++] = records[seq++ % SYSTRACE_BUF_SIZE];
+    }
+
+    *cursor = seq;
+
+    return n;
+}
@@ -0,0 +1,103 @@
+#include <kernel/trace.h>
+#include <kernel/clock.h>
+#include <kernel/serial.h>
+#include <kernel/smp.h>
+#include <kernel/sys.h>
+
+#include <stdlib.h>
+
+/* A ring of fixed-size binary records of scheduler, interrupt, system call,
+ * fault and WM events, cheap enough to keep timings mostly unperturbed.
+ * Writers reserve a slot with an atomic increment, so that no lock is needed;
+ * old records are overwritten when the ring is full.
+ * `trace_dump` streams the records over serial in the compact format described
+ * in `uapi_trace.h`, which `misc/trace2json.py` turns into a Chrome trace.
+ */
+
+bool trace_enabled = false;
+
+static trace_record_t* records = NULL;
+static uint32_t next_seq = 0;
+
+void trace_record(uint32_t event, uint32_t arg0, uint32_t arg1) {
+    uint32_t seq = __atomic_fetch_add(&next_seq, 1, __ATOMIC_RELAXED);
+
+    records[seq & (TRACE_BUF_SIZE - 1)] = (trace_record_t) {
+        .time = clock_get_ns(),
+        .event = event,
+        .cpu = smp_current_cpu(),
+        .args = { arg0, arg1 }
+    };
+}
+
+/* Discards previous records and starts recording.
+ */
+void trace_start() {
+    if (!records) {
+        records = kmalloc(TRACE_BUF_SIZE * sizeof(trace_record_t));
+    }
+
+    next_seq = 0;
+    trace_enabled = true;
+}
+
+/* Stops recording. Returns the number of records in the ring.
+ */
+uint32_t trace_stop() {
+    trace_enabled = false;
+
+    return next_seq < TRACE_BUF_SIZE ? next_seq : TRACE_BUF_SIZE;
+}
+
+static void trace_write_u32(uint32_t n) {
+    serial_write_raw((uint8_t*) &n, sizeof(n));
+}
+
+static void trace_write_varint(uint64_t n) {
+    uint8_t buf[10];
+    uint32_t len = 0;
+
+    do {
+        buf[len] = n & 0x7F;
+        n >>= 7;
+
+        if (n) {
+            buf[len] |= 0x80;
+        }
+
+        len++;
+    } while (n);
+
+    serial_write_raw(buf, len);
+}
+
+/* Stops recording and writes the records to the serial port, oldest first.
+ */
+void trace_dump() {
+    uint32_t count = trace_stop();
+    uint32_t first = next_seq - count;
+    uint64_t last_time = 0;
+
+    serial_write_raw((uint8_t*) TRACE_DUMP_MAGIC, 8);
+    trace_write_u32(count);
+    trace_write_u32(first);
+
+    for (uint32_t seq = first; seq != next_seq; seq++) {
+        trace_record_t* rec = &records[seq & (TRACE_BUF_SIZE - 1)];
+        uint8_t head[2] = { rec->event, rec->cpu };
+
+        // Records can be stamped out of order, e.g. when an interrupt comes
+        // between reserving a slot and reading the clock
+        int64_t delta = rec->time - last_time;
+
+        serial_write_raw(head, sizeof(head));
+        trace_write_varint(((uint64_t) delta << 1) ^ (delta >> 63));
+        trace_write_varint(rec->args[0]);
+        trace_write_varint(rec->args[1]);
+
+        last_time = rec->time;
+    }
+
+    uint8_t end = TRACE_DUMP_END;
+    serial_write_raw(&end, 1);
+}
@@ -0,0 +1,86 @@
+#include <kernel/workqueue.h>
+#include <kernel/irq.h>
+#include <kernel/proc.h>
+#include <kernel/sys.h>
+
+#include <stdlib.h>
+
+/* Work queues let interrupt handlers do the bare minimum and return, leaving
+ * the rest to a kernel thread, e.g. the window manager's compositing.
+ * Kernel threads run with interrupts enabled, so the queue is only accessed
+ * with interrupts masked; work items themselves run unmasked.
+ */
+
+/* The code of the work queue's thread: runs work items as they come.
+ */
+static void workqueue_thread(void* arg) {
+    workqueue_t* wq = arg;
+
+    while (true) {
+        uint32_t eflags = irq_save();
+        work_t* work = wq->head;
+
+        // Nothing may be queued between the check and going to sleep
+        if (!work) {
+            proc_wait(&wq->idle, 0);
+            irq_restore(eflags);
+            continue;
+        }
+
+        wq->head = work->next;
+
+        if (!wq->head) {
+            wq->tail = NULL;
+        }
+
+        // It may be queued again from here on
+        work->pending = false;
+        irq_restore(eflags);
+
+        work->fn(work->arg);
+    }
+}
+
+/* Creates a work queue and the kernel thread that serves it.
+ */
+workqueue_t* workqueue_new() {
+    workqueue_t* wq = kmalloc(sizeof(workqueue_t));
+
+    *wq = (workqueue_t) {
+        .head = NULL,
+        .tail = NULL,
+        .idle = LIST_HEAD_INIT(wq->idle)
+    };
+
+    wq->thread = proc_create_kthread(workqueue_thread, wq);
+
+    return wq;
+}
+
+/* Queues `work` to be run by the work queue's thread, unless it's already
+ * queued. Returns whether it was queued.
+ * Safe to call from interrupt handlers.
+ */
+bool workqueue_push(workqueue_t* wq, work_t* work) {
+    uint32_t eflags = irq_save();
+
+    if (work->pending) {
+        irq_restore(eflags);
+        return false;
+    }
+
+    work->pending = true;
+    work->next = NULL;
+
+    if (wq->tail) {
+        wq->tail->next = work;
+    } else {
+        wq->head = work;
+    }
+
+    wq->tail = work;
+    proc_wake_all(&wq->idle);
+    irq_restore(eflags);
+
+    return true;
+}
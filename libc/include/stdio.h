@@ -29,6 +29,7 @@ int vsnprintf(char* str, size_t size, const char* format, va_list ap);
 #ifndef _KERNEL_
 FILE* fopen(const char* path, const char* mode);
 int fclose(FILE* stream);
+int fileno(FILE* stream);
 int fread(void* ptr, size_t size, size_t nmemb, FILE* stream);
 int fgetc(FILE* stream);
 int fwrite(const void* ptr, size_t size, size_t nmemb, FILE* stream);
@@ -1 +1,7 @@
-#pragma once
\ No newline at end of file
+#pragma once
+
+#include <stdint.h>
+
+typedef int32_t ssize_t;
+typedef int32_t off_t;
+typedef int32_t pid_t;
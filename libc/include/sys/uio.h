@@ -0,0 +1,12 @@
+#pragma once
+
+#include <kernel/uapi/uapi_fs.h>
+
+#include <sys/types.h>
+
+#define IOV_MAX FS_IOV_MAX
+
+#ifndef _KERNEL_
+ssize_t readv(int fd, const struct iovec* iov, int iovcnt);
+ssize_t writev(int fd, const struct iovec* iov, int iovcnt);
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <kernel/uapi/uapi_syscall.h>
+
+#include <sys/types.h>
+
+#define WNOHANG WAIT_NOHANG
+
+// Exit statuses are passed as is, processes can't be killed by signals
+#define WIFEXITED(status) 1
+#define WEXITSTATUS(status) (status)
+
+#ifndef _KERNEL_
+pid_t waitpid(pid_t pid, int* status, int options);
+pid_t wait(int* status);
+#endif
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define THREAD_STACK_SIZE 0x10000
+
+typedef struct _thread_desc_t {
+    int32_t tid;
+    void* (*fn)(void*);
+    void* arg;
+    void* ret;
+    uint8_t* stack;
+} thread_desc_t;
+
+typedef thread_desc_t* thread_t;
+
+/* Synchronization primitives, see `sync.c`. Initialize them with the
+ * corresponding `*_INIT` macro.
+ */
+typedef struct {
+    volatile uint32_t state; // 0: unlocked, 1: locked, 2: locked and contended
+} mutex_t;
+
+typedef struct {
+    volatile uint32_t seq; // Incremented on each signal
+    volatile uint32_t waiters;
+} cond_t;
+
+typedef struct {
+    volatile uint32_t value;
+    volatile uint32_t waiters;
+} sem_t;
+
+#define MUTEX_INIT ((mutex_t) { .state = 0 })
+#define COND_INIT ((cond_t) { .seq = 0, .waiters = 0 })
+#define SEM_INIT(n) ((sem_t) { .value = (n), .waiters = 0 })
+
+#ifndef _KERNEL_
+int thread_create(thread_t* thread, void* (*fn)(void*), void* arg);
+int thread_join(thread_t thread, void** ret);
+void thread_exit(void* ret);
+thread_t thread_self();
+
+int futex_wait(volatile uint32_t* addr, uint32_t val, uint32_t timeout);
+int futex_wake(volatile uint32_t* addr, uint32_t count);
+
+void mutex_lock(mutex_t* mutex);
+bool mutex_trylock(mutex_t* mutex);
+void mutex_unlock(mutex_t* mutex);
+
+void cond_wait(cond_t* cond, mutex_t* mutex);
+void cond_signal(cond_t* cond);
+void cond_broadcast(cond_t* cond);
+
+void sem_wait(sem_t* sem);
+bool sem_trywait(sem_t* sem);
+void sem_post(sem_t* sem);
+#endif
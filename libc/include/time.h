@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <kernel/uapi/uapi_syscall.h>
+
+typedef int32_t time_t;
+typedef uint32_t clockid_t;
+
+struct timespec {
+    time_t tv_sec;
+    long tv_nsec;
+};
+
+#ifndef _KERNEL_
+int clock_gettime(clockid_t clock, struct timespec* tp);
+#endif
@@ -3,6 +3,7 @@
 #include <kernel/uapi/uapi_fs.h>
 
 #include <stddef.h>
+#include <sys/types.h>
 
 #define STDOUT_FILENO FS_STDOUT_FILENO
 
@@ -11,5 +12,7 @@
 int chdir(const char* path);
 char* getcwd(char* buf, size_t size);
 int unlink(const char* path);
+ssize_t pread(int fd, void* buf, size_t count, off_t offset);
+ssize_t pwrite(int fd, const void* buf, size_t count, off_t offset);
 
 #endif
\ No newline at end of file
@@ -24,6 +24,16 @@ bool list_empty(list_t* list) {
     return list == list->next;
 }
 
+uint32_t list_count(list_t* list) {
+    uint32_t count = 0;
+
+    for (list_t* iter = list->next; iter != list; iter = iter->next) {
+        count++;
+    }
+
+    return count;
+}
+
 void __list_add(list_t* new, list_t* prev, list_t* next) {
     next->prev = new;
     new->next = next;
@@ -51,6 +51,12 @@ int fclose(FILE* stream) {
     return 0;
 }
 
+/* Returns the file descriptor backing `stream`.
+ */
+int fileno(FILE* stream) {
+    return stream->fd;
+}
+
 /* Reads at most `size*nmemb` into `ptr` from `stream`.
  * Returns the number of elements read.
  * If less than `nmemb` elements are read, EOF is placed after the last
@@ -3,6 +3,7 @@
 #include <kernel/uapi/uapi_syscall.h>
 
 #include <stdlib.h>
+#include <sys/wait.h>
 
 int32_t syscall1(uint32_t eax, uint32_t ebx);
 int32_t syscall2(uint32_t eax, uint32_t ebx, uint32_t ecx);
@@ -12,8 +13,18 @@ void exit(int status) {
     __builtin_unreachable();
 }
 
+/* Runs `command` and waits for it to exit.
+ * Returns its exit status, or -1 if it couldn't be started.
+ */
 int system(const char* command) {
-    return syscall2(SYS_EXEC, (uintptr_t) command, 0);
+    int status;
+    pid_t pid = syscall2(SYS_EXEC, (uintptr_t) command, 0);
+
+    if (pid < 0 || waitpid(pid, &status, 0) != pid) {
+        return -1;
+    }
+
+    return status;
 }
 
 #endif
\ No newline at end of file
@@ -6,7 +6,10 @@
 #ifdef _KERNEL_
 #include <kernel/paging.h>
 #include <kernel/pmm.h>
+#include <kernel/spinlock.h>
 #include <kernel/sys.h>
+#else
+#include <thread.h>
 #endif
 
 #define MIN_ALIGN 4
@@ -54,6 +57,31 @@ static void* sbrk(uint32_t size) {
     return (void*) addr;
 }
 
+/* Threads of a process share its heap, they take turns using it.
+ */
+static mutex_t heap_mutex = MUTEX_INIT;
+
+static void heap_lock() {
+    mutex_lock(&heap_mutex);
+}
+
+static void heap_unlock() {
+    mutex_unlock(&heap_mutex);
+}
+
+#else
+
+// The kernel heap is shared between CPUs
+static spinlock_t heap_spinlock = SPINLOCK_INIT;
+
+static void heap_lock() {
+    spinlock_acquire(&heap_spinlock);
+}
+
+static void heap_unlock() {
+    spinlock_release(&heap_spinlock);
+}
+
 #endif
 
 /* Debugging function to print the block list. Only sizes are listed, and a '#'
@@ -195,14 +223,16 @@ void free(void* pointer) {
         return;
     }
 
+    heap_lock();
+
     mem_block_t* block = mem_get_block(pointer);
     block->size &= ~1;
     used_memory -= block->size;
+
+    heap_unlock();
 }
 
-/* Returns `size` bytes of memory at an address multiple of `align`.
- */
-void* aligned_alloc(size_t align, size_t size) {
+static void* mem_alloc(size_t align, size_t size) {
     const uint32_t header_size = offsetof(mem_block_t, data);
     size = align_to(size, 8);
 
@@ -260,6 +290,16 @@ void* aligned_alloc(size_t align, size_t size) {
     return block->data;
 }
 
+/* Returns `size` bytes of memory at an address multiple of `align`.
+ */
+void* aligned_alloc(size_t align, size_t size) {
+    heap_lock();
+    void* ptr = mem_alloc(align, size);
+    heap_unlock();
+
+    return ptr;
+}
+
 #ifdef _KERNEL_
 /* Alias for `aligned_alloc`.
  * It's a naming habit, don't mind it.
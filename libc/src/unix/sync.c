@@ -0,0 +1,131 @@
+#ifndef _KERNEL_
+
+#include <thread.h>
+
+#include <kernel/uapi/uapi_futex.h>
+#include <kernel/uapi/uapi_syscall.h>
+
+extern int32_t syscall3(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx);
+extern int32_t syscall4(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx, uint32_t esi);
+
+/* Mutexes, condition variables and semaphores. They only enter the kernel,
+ * through futexes, when a thread has to block or to wake another one up.
+ */
+
+/* Blocks until `futex_wake` is called on `addr`, if it holds `val`, or for at
+ * most `timeout` ms if it isn't 0.
+ * Returns 0 once woken up, or `FUTEX_AGAIN` or `FUTEX_TIMEDOUT`.
+ */
+int futex_wait(volatile uint32_t* addr, uint32_t val, uint32_t timeout) {
+    return syscall4(SYS_FUTEX, FUTEX_CMD_WAIT, (uintptr_t) addr, val, timeout);
+}
+
+/* Wakes up at most `count` threads blocked on `addr`, returns how many.
+ */
+int futex_wake(volatile uint32_t* addr, uint32_t count) {
+    return syscall3(SYS_FUTEX, FUTEX_CMD_WAKE, (uintptr_t) addr, count);
+}
+
+/* Contended threads mark the mutex with state 2, telling the owner that it
+ * has someone to wake up when unlocking it.
+ */
+void mutex_lock(mutex_t* mutex) {
+    uint32_t c = 0;
+
+    if (__atomic_compare_exchange_n(&mutex->state, &c, 1, false,
+            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    if (c != 2) {
+        c = __atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE);
+    }
+
+    while (c != 0) {
+        futex_wait(&mutex->state, 2, 0);
+        c = __atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+/* Locks the mutex if it's free. Returns whether it did.
+ */
+bool mutex_trylock(mutex_t* mutex) {
+    uint32_t c = 0;
+
+    return __atomic_compare_exchange_n(&mutex->state, &c, 1, false,
+        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+void mutex_unlock(mutex_t* mutex) {
+    if (__atomic_fetch_sub(&mutex->state, 1, __ATOMIC_RELEASE) != 1) {
+        __atomic_store_n(&mutex->state, 0, __ATOMIC_RELEASE);
+        futex_wake(&mutex->state, 1);
+    }
+}
+
+/* Unlocks `mutex` and waits for the condition to be signaled, then locks
+ * `mutex` again. As usual, spurious wake ups are possible.
+ */
+void cond_wait(cond_t* cond, mutex_t* mutex) {
+    uint32_t seq = __atomic_load_n(&cond->seq, __ATOMIC_RELAXED);
+
+    __atomic_fetch_add(&cond->waiters, 1, __ATOMIC_RELAXED);
+    mutex_unlock(mutex);
+
+    // Returns right away if we were signaled in between
+    futex_wait(&cond->seq, seq, 0);
+
+    __atomic_fetch_sub(&cond->waiters, 1, __ATOMIC_RELAXED);
+    mutex_lock(mutex);
+}
+
+void cond_signal(cond_t* cond) {
+    __atomic_fetch_add(&cond->seq, 1, __ATOMIC_RELEASE);
+
+    if (__atomic_load_n(&cond->waiters, __ATOMIC_RELAXED)) {
+        futex_wake(&cond->seq, 1);
+    }
+}
+
+void cond_broadcast(cond_t* cond) {
+    __atomic_fetch_add(&cond->seq, 1, __ATOMIC_RELEASE);
+
+    if (__atomic_load_n(&cond->waiters, __ATOMIC_RELAXED)) {
+        futex_wake(&cond->seq, UINT32_MAX);
+    }
+}
+
+/* Takes one unit from the semaphore if it has any. Returns whether it did.
+ */
+bool sem_trywait(sem_t* sem) {
+    uint32_t v = __atomic_load_n(&sem->value, __ATOMIC_RELAXED);
+
+    while (v) {
+        if (__atomic_compare_exchange_n(&sem->value, &v, v - 1, false,
+                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Takes one unit from the semaphore, waiting for one to be posted if needed.
+ */
+void sem_wait(sem_t* sem) {
+    while (!sem_trywait(sem)) {
+        __atomic_fetch_add(&sem->waiters, 1, __ATOMIC_RELAXED);
+        futex_wait(&sem->value, 0, 0);
+        __atomic_fetch_sub(&sem->waiters, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void sem_post(sem_t* sem) {
+    __atomic_fetch_add(&sem->value, 1, __ATOMIC_RELEASE);
+
+    if (__atomic_load_n(&sem->waiters, __ATOMIC_RELAXED)) {
+        futex_wake(&sem->value, 1);
+    }
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef _KERNEL_
+
+#include <thread.h>
+#include <stdlib.h>
+
+#include <kernel/uapi/uapi_syscall.h>
+#include <kernel/uapi/uapi_thread.h>
+
+extern int32_t syscall2(uint32_t eax, uint32_t ebx, uint32_t ecx);
+extern int32_t syscall3(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx);
+extern int32_t syscall4(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx, uint32_t esi);
+
+/* Threads share the process's memory and files. Each one has its own stack,
+ * allocated here, and its descriptor as its TLS pointer.
+ */
+
+/* Where new threads start, with their descriptor as argument.
+ */
+static void thread_start(thread_t thread) {
+    thread_exit(thread->fn(thread->arg));
+}
+
+/* Starts running `fn(arg)` in a new thread, whose handle is stored in
+ * `thread`. Returns 0 on success, -1 on failure.
+ */
+int thread_create(thread_t* thread, void* (*fn)(void*), void* arg) {
+    thread_t t = malloc(sizeof(thread_desc_t));
+    uint8_t* stack = malloc(THREAD_STACK_SIZE);
+
+    if (!t || !stack) {
+        free(t);
+        free(stack);
+        return -1;
+    }
+
+    *t = (thread_desc_t) {
+        .fn = fn,
+        .arg = arg,
+        .stack = stack
+    };
+
+    /* Set up the stack as if `thread_start(t)` had been called, with the
+     * argument 16-bytes aligned as the ABI expects */
+    uint32_t* sp = (uint32_t*) (((uintptr_t) stack + THREAD_STACK_SIZE) & ~0xF);
+    *(--sp) = 0; // Padding
+    *(--sp) = 0;
+    *(--sp) = 0;
+    *(--sp) = (uintptr_t) t;
+    *(--sp) = 0; // Return address, `thread_start` doesn't return
+
+    t->tid = syscall4(SYS_THREAD, THREAD_CMD_CREATE, (uintptr_t) thread_start,
+        (uintptr_t) sp, (uintptr_t) t);
+
+    if (t->tid < 0) {
+        free(stack);
+        free(t);
+        return -1;
+    }
+
+    *thread = t;
+
+    return 0;
+}
+
+/* Waits for `thread` to exit, stores the value it returned in `ret` if it
+ * isn't NULL, and frees it. Returns 0 on success, -1 on failure.
+ */
+int thread_join(thread_t thread, void** ret) {
+    if (syscall3(SYS_THREAD, THREAD_CMD_JOIN, thread->tid, 0) < 0) {
+        return -1;
+    }
+
+    if (ret) {
+        *ret = thread->ret;
+    }
+
+    free(thread->stack);
+    free(thread);
+
+    return 0;
+}
+
+/* Exits the current thread with `ret` as return value. When called from the
+ * main thread, exits the process instead.
+ */
+void thread_exit(void* ret) {
+    thread_t self = thread_self();
+
+    if (self) {
+        self->ret = ret;
+    }
+
+    syscall2(SYS_THREAD, THREAD_CMD_EXIT, (uintptr_t) ret);
+}
+
+/* Returns the current thread's handle, NULL for the main thread.
+ */
+thread_t thread_self() {
+    return (thread_t) syscall2(SYS_THREAD, THREAD_CMD_GET_TLS, 0);
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef _KERNEL_
+
+#include <time.h>
+
+#include <kernel/uapi/uapi_syscall.h>
+#include <kernel/uapi/uapi_kinfo.h>
+
+extern int32_t syscall2(uint32_t eax, uint32_t ebx, uint32_t ecx);
+
+/* Computes the monotonic clock from the kernel info page, without a system
+ * call. Returns false if the kernel doesn't use the TSC.
+ */
+static bool clock_from_kinfo(uint64_t* ns) {
+    const volatile kinfo_t* kinfo = (const volatile kinfo_t*) KINFO_ADDR;
+    uint32_t seq;
+    uint64_t base, mult, tsc;
+
+    do {
+        seq = kinfo->seq;
+
+        if (!kinfo->tsc_valid) {
+            return false;
+        }
+
+        base = kinfo->tsc_base;
+        mult = kinfo->ns_per_cycle;
+    } while (seq % 2 || seq != kinfo->seq);
+
+    uint32_t low, high;
+    asm volatile ("rdtsc" : "=a" (low), "=d" (high));
+    tsc = (((uint64_t) high << 32) | low) - base;
+
+    // (tsc * mult) >> 32 without overflowing, see `clock.c`
+    uint64_t t_hi = tsc >> 32, t_lo = (uint32_t) tsc;
+    uint64_t m_hi = mult >> 32, m_lo = (uint32_t) mult;
+
+    *ns = ((t_hi * m_hi) << 32) + t_hi * m_lo + t_lo * m_hi + ((t_lo * m_lo) >> 32);
+
+    return true;
+}
+
+int clock_gettime(clockid_t clock, struct timespec* tp) {
+    uint64_t ns;
+
+    if (clock != CLOCK_MONOTONIC || !clock_from_kinfo(&ns)) {
+        int ret = syscall2(SYS_CLOCK, clock, (uintptr_t) &ns);
+
+        if (ret) {
+            return ret;
+        }
+    }
+
+    tp->tv_sec = ns / 1000000000;
+    tp->tv_nsec = ns % 1000000000;
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef _KERNEL_
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <kernel/uapi/uapi_syscall.h>
+
+extern int32_t syscall3(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx);
+extern int32_t syscall4(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx, uint32_t esi);
+
+/* Fills the buffers of `iov` in order with a single system call.
+ * Returns the number of bytes read, or -1 on error.
+ */
+ssize_t readv(int fd, const struct iovec* iov, int iovcnt) {
+    return syscall3(SYS_READV, fd, (uintptr_t) iov, iovcnt);
+}
+
+/* Writes the buffers of `iov` in order with a single system call.
+ * Returns the number of bytes written, or -1 on error.
+ */
+ssize_t writev(int fd, const struct iovec* iov, int iovcnt) {
+    return syscall3(SYS_WRITEV, fd, (uintptr_t) iov, iovcnt);
+}
+
+/* Reads at `offset` in the file without moving the file offset.
+ */
+ssize_t pread(int fd, void* buf, size_t count, off_t offset) {
+    return syscall4(SYS_PREAD, fd, (uintptr_t) buf, count, offset);
+}
+
+/* Writes at `offset` in the file without moving the file offset.
+ */
+ssize_t pwrite(int fd, const void* buf, size_t count, off_t offset) {
+    return syscall4(SYS_PWRITE, fd, (uintptr_t) buf, count, offset);
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef _KERNEL_
+
+#include <sys/wait.h>
+
+#include <kernel/uapi/uapi_syscall.h>
+
+extern int32_t syscall3(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx);
+
+/* Blocks until the child `pid` exits, or any child if `pid` is -1, and
+ * stores its exit status in `status` if it isn't NULL.
+ * Returns the pid of the child, 0 if it's still running and `WNOHANG` is
+ * passed, or -1 if there's no such child.
+ */
+pid_t waitpid(pid_t pid, int* status, int options) {
+    return syscall3(SYS_WAITPID, pid, (uintptr_t) status, options);
+}
+
+pid_t wait(int* status) {
+    return waitpid(-1, status, 0);
+}
+
+#endif
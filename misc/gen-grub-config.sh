@@ -4,7 +4,7 @@
 echo "insmod efi_gop" > "$GRUBCFG"
 
 echo "menuentry \"SnowflakeOS - Challenge Edition\" {" >> "$GRUBCFG"
-echo "    multiboot2 /boot/SnowflakeOS.kernel" >> "$GRUBCFG"
+echo "    multiboot2 /boot/SnowflakeOS.kernel $KERNEL_ARGS" >> "$GRUBCFG"
 
 for f in "$ISODIR"/modules/*; do
     bname=$(basename "$f")
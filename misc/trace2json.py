@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+
+# Converts a trace dumped over serial by the kernel (see `trace.c`) to the
+# Chrome trace event format, viewable in chrome://tracing or Perfetto.
+#     misc/trace2json.py serial.log > trace.json
+# The serial log may contain other output; the last dump in it is used.
+
+import argparse
+import json
+import os
+import re
+import sys
+
+MAGIC = b"SFTRACE\x02"
+END = 0xFF
+
+SWITCH = 1
+IRQ_ENTRY = 2
+IRQ_EXIT = 3
+SYSCALL_ENTRY = 4
+SYSCALL_EXIT = 5
+PAGE_FAULT = 6
+WM_RENDER_BEGIN = 7
+WM_RENDER_END = 8
+
+# Chrome trace "processes" grouping our tracks
+KERNEL_PID = 0 # One track per CPU for scheduling, one for its interrupts
+THREADS_PID = 1 # One track per thread for its system calls and faults
+
+IRQ_TID_BASE = 100
+WM_TID = 200
+
+UAPI_SYSCALL = os.path.join(os.path.dirname(__file__), "..", "kernel",
+    "include", "kernel", "uapi", "uapi_syscall.h")
+
+
+def syscall_names(path):
+    names = {}
+
+    try:
+        with open(path) as f:
+            for m in re.finditer(r"#define SYS_(\w+) (\d+)", f.read()):
+                if m.group(1) != "MAX":
+                    names[int(m.group(2))] = m.group(1).lower()
+    except OSError:
+        pass
+
+    return names
+
+
+class Truncated(Exception):
+    pass
+
+
+def read_byte(data, pos):
+    if pos >= len(data):
+        raise Truncated()
+
+    return data[pos]
+
+
+def read_varint(data, pos):
+    n = 0
+    shift = 0
+
+    while True:
+        byte = read_byte(data, pos)
+        pos += 1
+        n |= (byte & 0x7F) << shift
+        shift += 7
+
+        if not byte & 0x80:
+            return n, pos
+
+
+def decode(data):
+    start = data.rfind(MAGIC)
+
+    if start < 0:
+        sys.exit("no trace found")
+
+    pos = start + len(MAGIC)
+    count = int.from_bytes(data[pos:pos + 4], "little")
+    lost = int.from_bytes(data[pos + 4:pos + 8], "little")
+    pos += 8
+
+    records = []
+    time = 0
+
+    # Keep what was decoded if the log ends in the middle of the dump
+    try:
+        for _ in range(count):
+            event = read_byte(data, pos)
+            cpu = read_byte(data, pos + 1)
+            delta, pos = read_varint(data, pos + 2)
+            arg0, pos = read_varint(data, pos)
+            arg1, pos = read_varint(data, pos)
+            time += (delta >> 1) ^ -(delta & 1) # Zigzag-encoded
+            records.append((time, event, cpu, arg0, arg1))
+
+        truncated = read_byte(data, pos) != END
+    except Truncated:
+        truncated = True
+
+    if truncated:
+        print("warning: the trace seems truncated, %d of %d records decoded"
+            % (len(records), count), file=sys.stderr)
+
+    if lost:
+        print("warning: %d records were overwritten" % lost, file=sys.stderr)
+
+    return records
+
+
+def to_chrome(records, names):
+    events = []
+    current = {} # Thread running on each CPU, with the time it started
+    open_calls = {} # Number of unfinished system calls per thread
+    threads = set()
+    cpus = set()
+
+    def us(ns):
+        return ns / 1000.0
+
+    def run(cpu, tid, time):
+        if cpu in current and current[cpu][0] != tid and current[cpu][1] < time:
+            prev, since = current[cpu]
+            events.append({"ph": "X", "pid": KERNEL_PID, "tid": cpu,
+                "name": "thread %d" % prev, "ts": us(since), "dur": us(time - since)})
+
+        if cpu not in current or current[cpu][0] != tid:
+            current[cpu] = (tid, time)
+
+    for time, event, cpu, arg0, arg1 in records:
+        cpus.add(cpu)
+
+        if event == SWITCH:
+            run(cpu, arg0, time)
+            run(cpu, arg1, time)
+        elif event in (IRQ_ENTRY, IRQ_EXIT):
+            run(cpu, arg1, time)
+            events.append({"ph": "B" if event == IRQ_ENTRY else "E",
+                "pid": KERNEL_PID, "tid": IRQ_TID_BASE + cpu,
+                "name": "irq %d" % arg0, "ts": us(time)})
+        elif event == SYSCALL_ENTRY:
+            run(cpu, arg1, time)
+            threads.add(arg1)
+            open_calls[arg1] = open_calls.get(arg1, 0) + 1
+            events.append({"ph": "B", "pid": THREADS_PID, "tid": arg1,
+                "name": names.get(arg0, "syscall %d" % arg0), "ts": us(time)})
+        elif event == SYSCALL_EXIT:
+            tid = current.get(cpu, (None,))[0]
+
+            # Calls made before the trace started have no beginning
+            if not open_calls.get(tid):
+                continue
+
+            open_calls[tid] -= 1
+            ret = arg1 - (1 << 32) if arg1 & 0x80000000 else arg1
+            events.append({"ph": "E", "pid": THREADS_PID, "tid": tid,
+                "ts": us(time), "args": {"ret": ret}})
+        elif event == PAGE_FAULT:
+            tid = current.get(cpu, (0,))[0]
+            events.append({"ph": "i", "s": "t", "pid": THREADS_PID, "tid": tid,
+                "name": "page fault", "ts": us(time),
+                "args": {"address": hex(arg0), "eip": hex(arg1)}})
+        elif event in (WM_RENDER_BEGIN, WM_RENDER_END):
+            begin = event == WM_RENDER_BEGIN
+            events.append({"ph": "B" if begin else "E", "pid": KERNEL_PID,
+                "tid": WM_TID, "name": "window %d" % arg0 if arg0 else "screen",
+                "ts": us(time), "args": {"pixels": arg1} if begin else {}})
+
+    if records:
+        for cpu in list(current):
+            run(cpu, None, records[-1][0])
+
+    meta = [
+        {"ph": "M", "pid": KERNEL_PID, "name": "process_name", "args": {"name": "kernel"}},
+        {"ph": "M", "pid": THREADS_PID, "name": "process_name", "args": {"name": "threads"}},
+        {"ph": "M", "pid": KERNEL_PID, "tid": WM_TID, "name": "thread_name",
+            "args": {"name": "WM render"}}
+    ]
+
+    for cpu in sorted(cpus):
+        meta.append({"ph": "M", "pid": KERNEL_PID, "tid": cpu, "name": "thread_name",
+            "args": {"name": "CPU %d" % cpu}})
+        meta.append({"ph": "M", "pid": KERNEL_PID, "tid": IRQ_TID_BASE + cpu,
+            "name": "thread_name", "args": {"name": "CPU %d interrupts" % cpu}})
+
+    for tid in sorted(threads):
+        meta.append({"ph": "M", "pid": THREADS_PID, "tid": tid, "name": "thread_name",
+            "args": {"name": "thread %d" % tid}})
+
+    return {"traceEvents": meta + events, "displayTimeUnit": "ns"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("log", help="serial output containing a trace dump")
+    parser.add_argument("-o", "--output", help="output file, stdout by default")
+    parser.add_argument("--syscalls", default=UAPI_SYSCALL,
+        help="header defining the system call numbers")
+    args = parser.parse_args()
+
+    with open(args.log, "rb") as f:
+        records = decode(f.read())
+
+    trace = to_chrome(records, syscall_names(args.syscalls))
+    out = open(args.output, "w") if args.output else sys.stdout
+    json.dump(trace, out)
+
+
+if __name__ == "__main__":
+    main()
@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
+#include <sys/wait.h>
 
 int main() {
     fb_t scr;
@@ -29,16 +31,19 @@ int main() {
     snow_render_window(win);
 
     while (true) {
-        wm_event_t evt = snow_get_event(win);
+        wm_event_t evt = snow_wait_event(win, 500);
 
         if (evt.type == WM_EVENT_KBD && evt.kbd.keycode == KBD_T) {
             syscall2(SYS_EXEC, (uintptr_t) "terminal", (uintptr_t) NULL);
         }
 
-        sys_info_t info;
-        syscall2(SYS_INFO, SYS_INFO_UPTIME, (uintptr_t) &info);
+        // Forget about the terminals that were closed
+        while (waitpid(-1, NULL, WNOHANG) > 0) { }
 
-        uint32_t time = info.uptime;
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        uint32_t time = ts.tv_sec;
         uint32_t m = time / 60;
         uint32_t s = time % 60;
         itoa(m, time_text+8, 10);
@@ -55,8 +60,6 @@ int main() {
         snow_draw_rect(win->fb, 0, 0, win->fb.width, 22, 0x303030);
         snow_draw_string(win->fb, time_text, x, y, 0xFFFFFF);
         snow_render_window_partial(win, redraw);
-
-        snow_sleep(500);
     }
 
     snow_close_window(win);
@@ -0,0 +1,38 @@
+#include <snow.h>
+
+#include <stdio.h>
+#include <string.h>
+
+/* Prints the boot timeline recorded by the kernel: how long each phase of the
+ * boot took, up to the first frame of the desktop.
+ */
+
+int main(int argc, char* argv[]) {
+    boot_phase_t phases[BOOT_PHASE_MAX];
+    sys_info_t info = {
+        .boot_phases = phases
+    };
+
+    if (argc > 1 && !strcmp(argv[1], "--help")) {
+        printf("usage: %s\n", argv[0]);
+        return 0;
+    }
+
+    syscall2(SYS_INFO, SYS_INFO_BOOT, (uintptr_t) &info);
+
+    if (!info.boot_phase_count) {
+        printf("%s: no boot timeline, the CPU has no TSC\n", argv[0]);
+        return 1;
+    }
+
+    printf("%8s %8s  %s\n", "START us", "TIME us", "PHASE");
+
+    for (uint32_t i = 0; i < info.boot_phase_count; i++) {
+        printf("%8u %8u  %s\n", phases[i].start, phases[i].duration, phases[i].name);
+    }
+
+    boot_phase_t* last = &phases[info.boot_phase_count - 1];
+    printf("total: %u ms\n", (last->start + last->duration) / 1000);
+
+    return 0;
+}
@@ -211,15 +211,10 @@ int main() {
     strcpy(text_field->text, dispbuf);
 
     while (true) {
-        wm_event_t event = snow_get_event(app.win);
+        wm_event_t event = snow_wait_event(app.win, 0);
 
         ui_handle_input(app, event);
-
-        if (event.type) {
-            ui_draw(app);
-        }
-
-        snow_sleep(30);
+        ui_draw(app);
     }
 
     return 0;
@@ -106,8 +106,10 @@ int main() {
     folder_view_t* fv = fv_new("/");
     ui_set_root(files, W(fv));
 
+    ui_draw(files);
+
     while (running) {
-        wm_event_t e = snow_get_event(files.win);
+        wm_event_t e = snow_wait_event(files.win, 0);
         ui_handle_input(files, e);
         ui_draw(files);
     }
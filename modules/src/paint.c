@@ -83,11 +83,7 @@ int main(int argc, char* argv[]) {
     }
 
     while (running) {
-        wm_event_t event = snow_get_event(paint.win);
-
-        if (!event.type) {
-            continue;
-        }
+        wm_event_t event = snow_wait_event(paint.win, 0);
 
         if (event.type == WM_EVENT_KBD && event.kbd.keycode == KBD_ESCAPE) {
             running = false;
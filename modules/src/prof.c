@@ -0,0 +1,167 @@
+#include <snow.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#include <kernel/uapi/uapi_prof.h>
+
+/* Controls the kernel's sampling profiler, and summarizes its samples: kernel
+ * ones by symbol, user ones by thread.
+ * `prof PROGRAM [ ARGS... ]` profiles the system while the program runs.
+ */
+
+#define BATCH 64
+#define MAX_ENTRIES 256
+#define TOP 15
+#define SYMBOL_LEN 48
+
+typedef struct {
+    uint32_t key; // Symbol address or thread id
+    uint32_t count;
+    char name[SYMBOL_LEN];
+} entry_t;
+
+static entry_t kernel_entries[MAX_ENTRIES];
+static entry_t user_entries[MAX_ENTRIES];
+static uint32_t kernel_count = 0;
+static uint32_t user_count = 0;
+
+/* Counts a sample for `key`. Returns its entry if it's the first sample for
+ * it, NULL otherwise. Samples that don't fit in the table are counted in the
+ * last entry.
+ */
+static entry_t* add_sample(entry_t* entries, uint32_t* count, uint32_t key) {
+    for (uint32_t i = 0; i < *count; i++) {
+        if (entries[i].key == key) {
+            entries[i].count++;
+            return NULL;
+        }
+    }
+
+    if (*count == MAX_ENTRIES) {
+        entries[MAX_ENTRIES - 1].count++;
+        strcpy(entries[MAX_ENTRIES - 1].name, "(others)");
+        return NULL;
+    }
+
+    entries[*count] = (entry_t) { .key = key, .count = 1 };
+
+    return &entries[(*count)++];
+}
+
+static void print_top(const char* title, entry_t* entries, uint32_t count,
+        uint32_t total) {
+    if (!count) {
+        return;
+    }
+
+    // Insertion sort, by decreasing count
+    for (uint32_t i = 1; i < count; i++) {
+        entry_t e = entries[i];
+        uint32_t j = i;
+
+        while (j && entries[j - 1].count < e.count) {
+            entries[j] = entries[j - 1];
+            j--;
+        }
+
+        entries[j] = e;
+    }
+
+    printf("%s:\n", title);
+
+    for (uint32_t i = 0; i < count && i < TOP; i++) {
+        printf("%6u %3u%% %s\n", entries[i].count,
+            entries[i].count * 100 / total, entries[i].name);
+    }
+}
+
+static void report(uint32_t total) {
+    prof_sample_t samples[BATCH];
+    uint32_t offset = 0;
+    uint32_t in_kernel = 0;
+    uint32_t n;
+
+    if (!total) {
+        printf("no samples\n");
+        return;
+    }
+
+    while ((n = syscall4(SYS_PROF, PROF_CMD_READ, (uintptr_t) samples, BATCH, offset))) {
+        for (uint32_t i = 0; i < n; i++) {
+            prof_sample_t* s = &samples[i];
+            entry_t* e;
+
+            if (s->flags & PROF_SAMPLE_USER) {
+                if ((e = add_sample(user_entries, &user_count, s->pid))) {
+                    snprintf(e->name, SYMBOL_LEN, "thread %u", s->pid);
+                }
+
+                continue;
+            }
+
+            char name[SYMBOL_LEN];
+            uint32_t addr = syscall4(SYS_PROF, PROF_CMD_SYMBOL, s->eip,
+                (uintptr_t) name, SYMBOL_LEN);
+
+            if (!addr) {
+                addr = s->eip;
+                snprintf(name, SYMBOL_LEN, "0x%X", s->eip);
+            }
+
+            if ((e = add_sample(kernel_entries, &kernel_count, addr))) {
+                strcpy(e->name, name);
+            }
+
+            in_kernel++;
+        }
+
+        offset += n;
+    }
+
+    printf("%u samples, %u%% in the kernel\n", total, in_kernel * 100 / total);
+    print_top("kernel", kernel_entries, kernel_count, total);
+    print_top("user", user_entries, user_count, total);
+}
+
+static void usage(const char* name) {
+    printf("usage: %s start [ HZ ]\n", name);
+    printf("       %s stop\n", name);
+    printf("       %s dump\n", name);
+    printf("       %s PROGRAM [ ARGS... ]\n", name);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || !strcmp(argv[1], "--help")) {
+        usage(argv[0]);
+        return 0;
+    }
+
+    if (!strcmp(argv[1], "start")) {
+        uint32_t freq = argc > 2 ? atoi(argv[2]) : 0;
+
+        freq = syscall2(SYS_PROF, PROF_CMD_START, freq);
+        printf("sampling at %u Hz\n", freq);
+    } else if (!strcmp(argv[1], "stop")) {
+        report(syscall1(SYS_PROF, PROF_CMD_STOP));
+    } else if (!strcmp(argv[1], "dump")) {
+        syscall1(SYS_PROF, PROF_CMD_DUMP);
+    } else {
+        int status;
+
+        syscall2(SYS_PROF, PROF_CMD_START, 0);
+        pid_t pid = syscall2(SYS_EXEC, (uintptr_t) argv[1], (uintptr_t) &argv[1]);
+
+        if (pid < 0 || waitpid(pid, &status, 0) != pid) {
+            printf("%s: failed to run '%s'\n", argv[0], argv[1]);
+            syscall1(SYS_PROF, PROF_CMD_STOP);
+            return 1;
+        }
+
+        report(syscall1(SYS_PROF, PROF_CMD_STOP));
+    }
+
+    return 0;
+}
@@ -0,0 +1,206 @@
+#include <snow.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#include <kernel/uapi/uapi_systrace.h>
+
+/* Runs a program while printing the system calls it makes, with their
+ * arguments, return values and durations.
+ * With `-c`, prints how many times each system call was made since boot and
+ * how long they took instead.
+ */
+
+#define BATCH 32
+#define POLL_MS 20
+
+typedef struct {
+    const char* name;
+    uint32_t nargs;
+} syscall_desc_t;
+
+static const syscall_desc_t syscalls[SYS_MAX] = {
+    [SYS_YIELD] = { "yield", 0 },
+    [SYS_EXIT] = { "exit", 0 },
+    [SYS_SLEEP] = { "sleep", 1 },
+    [SYS_PUTCHAR] = { "putchar", 1 },
+    [SYS_SBRK] = { "sbrk", 1 },
+    [SYS_WM] = { "wm", 2 },
+    [SYS_INFO] = { "info", 2 },
+    [SYS_EXEC] = { "exec", 2 },
+    [SYS_OPEN] = { "open", 2 },
+    [SYS_CLOSE] = { "close", 1 },
+    [SYS_READ] = { "read", 3 },
+    [SYS_READDIR] = { "readdir", 2 },
+    [SYS_WRITE] = { "write", 3 },
+    [SYS_MKDIR] = { "mkdir", 2 },
+    [SYS_FSEEK] = { "fseek", 3 },
+    [SYS_FTELL] = { "ftell", 1 },
+    [SYS_CHDIR] = { "chdir", 1 },
+    [SYS_GETCWD] = { "getcwd", 2 },
+    [SYS_UNLINK] = { "unlink", 1 },
+    [SYS_RENAME] = { "rename", 2 },
+    [SYS_MAKETTY] = { "maketty", 0 },
+    [SYS_STAT] = { "stat", 2 },
+    [SYS_CLOCK] = { "clock", 2 },
+    [SYS_GETPID] = { "getpid", 0 },
+    [SYS_READV] = { "readv", 3 },
+    [SYS_WRITEV] = { "writev", 3 },
+    [SYS_PREAD] = { "pread", 4 },
+    [SYS_PWRITE] = { "pwrite", 4 },
+    [SYS_RING] = { "ring", 2 },
+    [SYS_SYSTRACE] = { "systrace", 4 },
+    [SYS_WAITPID] = { "waitpid", 3 },
+    [SYS_THREAD] = { "thread", 4 },
+    [SYS_FUTEX] = { "futex", 4 },
+    [SYS_PROCSTAT] = { "procstat", 2 },
+    [SYS_PROF] = { "prof", 4 },
+    [SYS_TRACE] = { "trace", 1 }
+};
+
+static uint64_t ns_per_cycle = 0;
+
+/* (cycles * ns_per_cycle) >> 32, computed by 32 bits halves as the full
+ * product would take 128 bits, see `clock_cycles_to_ns` in the kernel.
+ */
+static uint64_t to_ns(uint64_t cycles) {
+    uint64_t c_hi = cycles >> 32, c_lo = (uint32_t) cycles;
+    uint64_t m_hi = ns_per_cycle >> 32, m_lo = (uint32_t) ns_per_cycle;
+
+    return ((c_hi * m_hi) << 32) + c_hi * m_lo + c_lo * m_hi + ((c_lo * m_lo) >> 32);
+}
+
+static const char* syscall_name(uint32_t n) {
+    return n < SYS_MAX && syscalls[n].name ? syscalls[n].name : "unknown";
+}
+
+static void print_record(const systrace_record_t* rec) {
+    uint32_t nargs = rec->syscall < SYS_MAX ? syscalls[rec->syscall].nargs : 4;
+
+    printf("[%d] %s(", rec->pid, syscall_name(rec->syscall));
+
+    for (uint32_t i = 0; i < nargs; i++) {
+        printf(i ? ", 0x%X" : "0x%X", rec->args[i]);
+    }
+
+    if (rec->syscall == SYS_EXIT) {
+        printf(")\n");
+    } else {
+        printf(") = %d <%llu ns>\n", rec->ret, to_ns(rec->cycles));
+    }
+}
+
+static void print_summary() {
+    systrace_stats_t* stats = malloc(sizeof(systrace_stats_t));
+
+    if (syscall3(SYS_SYSTRACE, SYSTRACE_CMD_STATS, (uintptr_t) stats, 0)) {
+        printf("failed to get statistics\n");
+        free(stats);
+        return;
+    }
+
+    printf("%-10s %10s %10s %10s\n", "syscall", "calls", "avg ns", "max ns");
+
+    for (uint32_t n = 0; n < SYS_MAX; n++) {
+        if (!stats->count[n]) {
+            continue;
+        }
+
+        // Upper bound of the slowest non-empty histogram bucket
+        uint32_t max_bucket = 0;
+
+        for (uint32_t b = 0; b < SYSTRACE_BUCKETS; b++) {
+            if (stats->histogram[n][b]) {
+                max_bucket = b;
+            }
+        }
+
+        uint64_t max_cycles = (uint64_t) 1 << (max_bucket + SYSTRACE_BUCKET_SHIFT);
+
+        printf("%-10s %10u %10llu %9s%llu\n", syscall_name(n), stats->count[n],
+            to_ns(stats->cycles[n] / stats->count[n]),
+            max_bucket == SYSTRACE_BUCKETS - 1 ? ">" : "<", to_ns(max_cycles));
+    }
+
+    free(stats);
+}
+
+/* Moves `cursor` past the records currently in the trace buffer.
+ */
+static void skip_records(uint32_t* cursor) {
+    systrace_record_t recs[BATCH];
+
+    while (syscall4(SYS_SYSTRACE, SYSTRACE_CMD_READ, (uintptr_t) recs, BATCH,
+            (uintptr_t) cursor)) { }
+}
+
+int main(int argc, char* argv[]) {
+    kinfo_t info;
+
+    if (argc < 2 || !strcmp(argv[1], "--help")) {
+        printf("usage: %s PROGRAM [ ARGS... ]\n", argv[0]);
+        printf("       %s -c\n", argv[0]);
+        return 0;
+    }
+
+    snow_get_kinfo(&info);
+
+    if (info.tsc_valid) {
+        ns_per_cycle = info.ns_per_cycle;
+    }
+
+    if (!strcmp(argv[1], "-c")) {
+        print_summary();
+        return 0;
+    }
+
+    uint32_t cursor = 0;
+    uint32_t expected = 0;
+    bool exited = false;
+    int status = 0;
+
+    skip_records(&cursor);
+    expected = cursor;
+
+    syscall2(SYS_SYSTRACE, SYSTRACE_CMD_FOLLOW, true);
+    pid_t pid = syscall2(SYS_EXEC, (uintptr_t) argv[1], (uintptr_t) &argv[1]);
+    syscall2(SYS_SYSTRACE, SYSTRACE_CMD_FOLLOW, false);
+
+    if (pid < 0) {
+        printf("%s: failed to run '%s'\n", argv[0], argv[1]);
+        return 1;
+    }
+
+    while (true) {
+        // Once it has exited, everything it did is in the trace buffer
+        if (!exited && waitpid(pid, &status, WNOHANG) == pid) {
+            exited = true;
+        }
+
+        systrace_record_t recs[BATCH];
+        uint32_t n = syscall4(SYS_SYSTRACE, SYSTRACE_CMD_READ, (uintptr_t) recs,
+            BATCH, (uintptr_t) &cursor);
+
+        for (uint32_t i = 0; i < n; i++) {
+            if (recs[i].seq != expected) {
+                printf("... %u calls lost\n", recs[i].seq - expected);
+            }
+
+            expected = recs[i].seq + 1;
+            print_record(&recs[i]);
+        }
+
+        if (!n && exited) {
+            printf("exit status %d\n", WEXITSTATUS(status));
+            break;
+        }
+
+        if (!n) {
+            snow_sleep(POLL_MS);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <snow.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Measures the latency of a system call that does nothing, through both the
+ * `int $0x30` and `sysenter` paths, and when batched through a ring.
+ */
+
+#define DEFAULT_ITERATIONS 100000
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void getpid_int() {
+    uint32_t eax = SYS_GETPID;
+
+    asm volatile ("int $0x30" : "+a" (eax) :: "memory");
+}
+
+static void getpid_sysenter() {
+    syscall(SYS_GETPID);
+}
+
+static ring_t ring;
+
+/* Runs `RING_SIZE` calls per system call.
+ */
+static void getpid_ring(uint32_t iterations) {
+    uint32_t done = 0;
+
+    while (done < iterations) {
+        ring_sqe_t* sqe;
+        ring_cqe_t* cqe;
+
+        for (uint32_t i = done; i < iterations && (sqe = snow_ring_get_sqe(&ring)); i++) {
+            snow_ring_prep(sqe, SYS_GETPID, i, 0, 0, 0, 0);
+        }
+
+        snow_ring_submit(&ring);
+
+        while ((cqe = snow_ring_peek_cqe(&ring))) {
+            snow_ring_cqe_seen(&ring);
+            done++;
+        }
+    }
+}
+
+static void bench(const char* name, void (*fn)(), uint32_t iterations) {
+    uint64_t start = now_ns();
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        fn();
+    }
+
+    uint64_t elapsed = now_ns() - start;
+
+    printf("%s: %u calls, %u ns per call\n", name, iterations,
+        (uint32_t) (elapsed / iterations));
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t iterations = DEFAULT_ITERATIONS;
+    kinfo_t info;
+
+    if (argc > 1) {
+        if (!strcmp(argv[1], "--help")) {
+            printf("usage: %s [ iterations ]\n", argv[0]);
+            return 0;
+        }
+
+        iterations = atoi(argv[1]);
+    }
+
+    if (!iterations) {
+        iterations = DEFAULT_ITERATIONS;
+    }
+
+    snow_get_kinfo(&info);
+
+    bench("int $0x30", getpid_int, iterations);
+
+    if (info.sysenter) {
+        bench("sysenter", getpid_sysenter, iterations);
+    } else {
+        printf("sysenter: not supported\n");
+    }
+
+    if (snow_ring_setup(&ring) == 0) {
+        uint64_t start = now_ns();
+        getpid_ring(iterations);
+        uint64_t elapsed = now_ns() - start;
+
+        printf("ring: %u calls, %u ns per call\n", iterations,
+            (uint32_t) (elapsed / iterations));
+    }
+
+    return 0;
+}
@@ -3,7 +3,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
 #include <ui.h>
+#include <sys/wait.h>
 
 typedef struct {
     char* buf;
@@ -17,6 +19,7 @@ str_t* str_new(const char* str);
 void str_free(str_t* str);
 void str_append(str_t* str, const char* text);
 void interpret_cmd(str_t* text_buf, str_t* cmd);
+void reap_children(str_t* text_buf);
 uint32_t count_lines(str_t* str);
 char* scroll_view(char* str);
 
@@ -36,6 +39,7 @@ window_t* win;
 bool cursor = true;
 bool running = true;
 bool focused = true;
+pid_t child = 0; // Command running in the foreground, if any
 
 int main() {
     win = snow_open_window("Terminal", twidth, theight, WM_NORMAL);
@@ -51,7 +55,8 @@ int main() {
     redraw(text_buf, input_buf);
 
     while (running) {
-        wm_event_t event = snow_get_event(win);
+        // Wake up regularly to blink the cursor and print commands' output
+        wm_event_t event = snow_wait_event(win, 50);
         wm_kbd_event_t key = event.kbd;
         bool needs_redrawing = false;
 
@@ -67,10 +72,10 @@ int main() {
 
         // Time & cursor blinks
         if (focused) {
-            sys_info_t info;
-            syscall2(SYS_INFO, SYS_INFO_UPTIME, (uintptr_t) &info);
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
 
-            uint32_t time = (uint32_t) (info.uptime / cursor_blink_time);
+            uint32_t time = (uint32_t) (ts.tv_sec / cursor_blink_time);
 
             if (time != last_time) {
                 last_time = time;
@@ -79,21 +84,29 @@ int main() {
             }
         }
 
-        // Print things that have been output, if any, and append a prompt
+        // Print things that have been output, if any
         const uint32_t buf_size = 256;
         char buf[buf_size];
         uint32_t read;
-        bool anything_read = false;
+        pid_t running_child = child;
+
+        // Reap first, so that we print everything a finished command output
+        reap_children(text_buf);
 
         while ((read = fread(buf, 1, buf_size - 1, stdout))) {
             buf[read] = '\0';
             str_append(text_buf, buf);
             needs_redrawing = true;
-            anything_read = true;
         }
 
-        if (anything_read) {
+        // Show a prompt again once the command is done
+        if (running_child && !child) {
+            if (text_buf->len && text_buf->buf[text_buf->len - 1] != '\n') {
+                str_append(text_buf, "\n");
+            }
+
             str_append(text_buf, prompt);
+            needs_redrawing = true;
         }
 
         if (event.type == WM_EVENT_KBD && event.kbd.pressed) {
@@ -102,11 +115,20 @@ int main() {
             switch (key.keycode) {
             case KBD_ENTER:
             case KBD_KP_ENTER:
+                // Wait for the current command to be done
+                if (child) {
+                    break;
+                }
+
                 str_append(text_buf, input_buf->buf);
+                str_append(text_buf, "\n");
                 interpret_cmd(text_buf, input_buf);
-                printf("\n");
                 input_buf->buf[0] = '\0';
                 input_buf->len = 0;
+
+                if (!child) {
+                    str_append(text_buf, prompt);
+                }
                 break;
             case KBD_BACKSPACE:
                 if (input_buf->len) {
@@ -259,18 +281,50 @@ void interpret_cmd(str_t* text_buf, str_t* input_buf) {
         return;
     }
 
-    int32_t ret = syscall2(SYS_EXEC, (uintptr_t) args[0], (uintptr_t) args);
+    // Commands ending with '&' run in the background
+    bool background = n_args > 1 && !strcmp(args[n_args - 1], "&");
+
+    if (background) {
+        free(args[n_args - 1]);
+        args[n_args - 1] = NULL;
+    }
+
+    pid_t pid = syscall2(SYS_EXEC, (uintptr_t) args[0], (uintptr_t) args);
 
-    while (args && *args) {
-        free(*args);
-        args++;
+    for (char** arg = args; *arg; arg++) {
+        free(*arg);
     }
 
     free(args);
 
-    if (ret != 0) {
-        str_append(text_buf, "\ninvalid command: ");
+    if (pid < 0) {
+        str_append(text_buf, "invalid command: ");
         str_append(text_buf, cmd);
+        str_append(text_buf, "\n");
+    } else if (!background) {
+        child = pid;
+    }
+}
+
+/* Collects the exit status of the commands that finished, reporting failures
+ * of the foreground one.
+ */
+void reap_children(str_t* text_buf) {
+    pid_t pid;
+    int status;
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        if (pid != child) {
+            continue;
+        }
+
+        child = 0;
+
+        if (WEXITSTATUS(status)) {
+            char msg[32];
+            snprintf(msg, sizeof(msg), "[exit status %d]\n", WEXITSTATUS(status));
+            str_append(text_buf, msg);
+        }
     }
 }
 
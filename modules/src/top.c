@@ -0,0 +1,124 @@
+#include <snow.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <kernel/uapi/uapi_procstat.h>
+
+/* Prints the CPU time, context switches, page faults, system calls and memory
+ * of every thread, along with its share of the CPU over the last second.
+ * `top N` prints N such reports, a second apart.
+ */
+
+#define INTERVAL_MS 1000
+
+static uint64_t ns_per_cycle = 0;
+
+static uint32_t to_ms(uint64_t cycles) {
+    return ((cycles / 1000000) * ns_per_cycle) >> 32;
+}
+
+/* Returns the accounting information of all threads, and their number in
+ * `count`.
+ */
+static procstat_t* sample(uint32_t* count) {
+    uint32_t n = 16;
+    procstat_t* stats = NULL;
+
+    // Threads may be created between two calls
+    while (true) {
+        stats = realloc(stats, n*sizeof(procstat_t));
+        *count = syscall2(SYS_PROCSTAT, (uintptr_t) stats, n);
+
+        if (*count <= n) {
+            return stats;
+        }
+
+        n = *count + 8;
+    }
+}
+
+static uint64_t cycles_of(const procstat_t* stat) {
+    return stat->user_cycles + stat->kernel_cycles;
+}
+
+/* Returns the cycles used by `pid` in `stats`, 0 if it's not there.
+ */
+static uint64_t cycles_of_pid(const procstat_t* stats, uint32_t count, uint32_t pid) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (stats[i].pid == pid) {
+            return cycles_of(&stats[i]);
+        }
+    }
+
+    return 0;
+}
+
+static void report(const procstat_t* before, uint32_t before_count,
+        const procstat_t* after, uint32_t after_count) {
+    uint64_t total = 0;
+
+    for (uint32_t i = 0; i < after_count; i++) {
+        total += cycles_of(&after[i]) - cycles_of_pid(before, before_count, after[i].pid);
+    }
+
+    printf("%5s %5s S %4s %8s %8s %6s %6s %7s %3s %6s %6s %s\n", "PID", "TGID",
+        "CPU%", "USR ms", "SYS ms", "VCSW", "IVCSW", "SYSCALL", "FLT", "RSS K",
+        "PEAK K", "NAME");
+
+    for (uint32_t i = 0; i < after_count; i++) {
+        const procstat_t* s = &after[i];
+        uint64_t used = cycles_of(s) - cycles_of_pid(before, before_count, s->pid);
+        uint32_t usage = total ? used * 100 / total : 0;
+
+        printf("%5u %5u %c %4u %8u %8u %6u %6u %7u %3u %6u %6u %s\n", s->pid,
+            s->tgid, s->state, usage, to_ms(s->user_cycles),
+            to_ms(s->kernel_cycles), s->voluntary_switches,
+            s->involuntary_switches, s->syscalls, s->page_faults, s->rss >> 10,
+            s->peak_rss >> 10, s->name);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    kinfo_t info;
+    uint32_t reports = argc > 1 ? atoi(argv[1]) : 1;
+
+    if (argc > 1 && !strcmp(argv[1], "--help")) {
+        printf("usage: %s [ COUNT ]\n", argv[0]);
+        return 0;
+    }
+
+    snow_get_kinfo(&info);
+
+    if (!info.tsc_valid) {
+        printf("%s: no TSC, times aren't accounted\n", argv[0]);
+    } else {
+        ns_per_cycle = info.ns_per_cycle;
+    }
+
+    uint32_t count;
+    procstat_t* before = sample(&count);
+
+    for (uint32_t i = 0; i < reports; i++) {
+        uint32_t after_count;
+
+        snow_sleep(INTERVAL_MS);
+
+        procstat_t* after = sample(&after_count);
+
+        if (i) {
+            printf("\n");
+        }
+
+        report(before, count, after, after_count);
+
+        free(before);
+        before = after;
+        count = after_count;
+    }
+
+    free(before);
+
+    return 0;
+}
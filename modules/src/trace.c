@@ -0,0 +1,52 @@
+#include <snow.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#include <kernel/uapi/uapi_trace.h>
+
+/* Controls the kernel's event tracing. Dumped traces go out over serial, see
+ * `misc/trace2json.py` to view them.
+ * `trace PROGRAM [ ARGS... ]` traces the system while the program runs, then
+ * dumps the trace.
+ */
+
+static void usage(const char* name) {
+    printf("usage: %s start\n", name);
+    printf("       %s stop\n", name);
+    printf("       %s dump\n", name);
+    printf("       %s PROGRAM [ ARGS... ]\n", name);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || !strcmp(argv[1], "--help")) {
+        usage(argv[0]);
+        return 0;
+    }
+
+    if (!strcmp(argv[1], "start")) {
+        syscall1(SYS_TRACE, TRACE_CMD_START);
+    } else if (!strcmp(argv[1], "stop")) {
+        printf("%d records\n", syscall1(SYS_TRACE, TRACE_CMD_STOP));
+    } else if (!strcmp(argv[1], "dump")) {
+        syscall1(SYS_TRACE, TRACE_CMD_DUMP);
+    } else {
+        int status;
+
+        syscall1(SYS_TRACE, TRACE_CMD_START);
+        pid_t pid = syscall2(SYS_EXEC, (uintptr_t) argv[1], (uintptr_t) &argv[1]);
+
+        if (pid < 0 || waitpid(pid, &status, 0) != pid) {
+            printf("%s: failed to run '%s'\n", argv[0], argv[1]);
+            syscall1(SYS_TRACE, TRACE_CMD_STOP);
+            return 1;
+        }
+
+        printf("%d records, dumping\n", syscall1(SYS_TRACE, TRACE_CMD_STOP));
+        syscall1(SYS_TRACE, TRACE_CMD_DUMP);
+    }
+
+    return 0;
+}
@@ -6,11 +6,14 @@
 #include <kernel/uapi/uapi_syscall.h>
 #include <kernel/uapi/uapi_wm.h>
 #include <kernel/uapi/uapi_kbd.h>
+#include <kernel/uapi/uapi_kinfo.h>
+#include <kernel/uapi/uapi_ring.h>
 
 int32_t syscall(uint32_t eax);
 int32_t syscall1(uint32_t eax, uint32_t ebx);
 int32_t syscall2(uint32_t eax, uint32_t ebx, uint32_t ecx);
 int32_t syscall3(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx);
+int32_t syscall4(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx, uint32_t esi);
 
 // Sets a magic breakpoint in Bochs on the line it's called.
 #define BREAK() do { \
@@ -27,6 +30,7 @@ typedef struct {
 } window_t;
 
 void snow_get_fb_info(fb_t* fb);
+void snow_get_kinfo(kinfo_t* info);
 void snow_sleep(uint32_t ms);
 
 // Drawing functions
@@ -46,4 +50,14 @@ void snow_close_window(window_t* win);
 void snow_draw_window(window_t* win);
 void snow_render_window(window_t* win);
 void snow_render_window_partial(window_t* win, wm_rect_t clip);
-wm_event_t snow_get_event(window_t* win);
\ No newline at end of file
+wm_event_t snow_get_event(window_t* win);
+wm_event_t snow_wait_event(window_t* win, uint32_t timeout);
+
+// Batched system calls
+int32_t snow_ring_setup(ring_t* ring);
+ring_sqe_t* snow_ring_get_sqe(ring_t* ring);
+void snow_ring_prep(ring_sqe_t* sqe, uint32_t syscall, uint32_t user_data,
+    uint32_t a, uint32_t b, uint32_t c, uint32_t d);
+int32_t snow_ring_submit(ring_t* ring);
+ring_cqe_t* snow_ring_peek_cqe(ring_t* ring);
+void snow_ring_cqe_seen(ring_t* ring);
\ No newline at end of file
@@ -106,5 +106,23 @@ wm_event_t snow_get_event(window_t* win) {
 
     syscall2(SYS_WM, WM_CMD_EVENT, (uintptr_t) &param);
 
+    return event;
+}
+
+/* Blocks until an event is available for the window and returns it. Returns
+ * an event of type 0 if `timeout` ms pass without one, unless `timeout` is 0,
+ * in which case it waits as long as needed.
+ */
+wm_event_t snow_wait_event(window_t* win, uint32_t timeout) {
+    wm_event_t event;
+
+    wm_param_event_t param = {
+        .win_id = win->id,
+        .event = &event,
+        .timeout = timeout
+    };
+
+    syscall2(SYS_WM, WM_CMD_WAIT_EVENT, (uintptr_t) &param);
+
     return event;
 }
\ No newline at end of file
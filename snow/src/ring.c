@@ -0,0 +1,70 @@
+#include <snow.h>
+
+#include <string.h>
+
+/* Helpers to batch system calls through a submission ring, see `uapi_ring.h`.
+ * Typical use:
+ *     ring_sqe_t* sqe = snow_ring_get_sqe(ring);
+ *     snow_ring_prep(sqe, SYS_READ, user_data, fd, (uintptr_t) buf, size, 0);
+ *     ... more submissions ...
+ *     snow_ring_submit(ring);
+ *     while ((cqe = snow_ring_peek_cqe(ring))) {
+ *         ... use cqe->result ...
+ *         snow_ring_cqe_seen(ring);
+ *     }
+ */
+
+/* Registers `ring` as the process's ring. It must stay allocated until the
+ * process exits or registers another one.
+ * Returns 0 on success.
+ */
+int32_t snow_ring_setup(ring_t* ring) {
+    memset(ring, 0, sizeof(ring_t));
+
+    return syscall2(SYS_RING, RING_CMD_SETUP, (uintptr_t) ring);
+}
+
+/* Returns the next free submission slot, or NULL if the ring is full.
+ * The slot is queued by the next `snow_ring_submit`.
+ */
+ring_sqe_t* snow_ring_get_sqe(ring_t* ring) {
+    if (ring->sq_tail - ring->sq_head >= RING_SIZE) {
+        return NULL;
+    }
+
+    return &ring->sq[ring->sq_tail++ % RING_SIZE];
+}
+
+void snow_ring_prep(ring_sqe_t* sqe, uint32_t syscall, uint32_t user_data,
+        uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    *sqe = (ring_sqe_t) {
+        .syscall = syscall,
+        .args = { a, b, c, d },
+        .user_data = user_data
+    };
+}
+
+/* Runs all queued submissions in a single system call, as long as there's
+ * room for their completions. Returns how many ran.
+ */
+int32_t snow_ring_submit(ring_t* ring) {
+    (void) ring; // The kernel knows our ring
+
+    return syscall2(SYS_RING, RING_CMD_ENTER, 0);
+}
+
+/* Returns the oldest unseen completion, or NULL if there's none.
+ */
+ring_cqe_t* snow_ring_peek_cqe(ring_t* ring) {
+    if (ring->cq_head == ring->cq_tail) {
+        return NULL;
+    }
+
+    return &ring->cq[ring->cq_head % RING_SIZE];
+}
+
+/* Frees the completion returned by `snow_ring_peek_cqe`.
+ */
+void snow_ring_cqe_seen(ring_t* ring) {
+    ring->cq_head++;
+}
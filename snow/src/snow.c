@@ -1,10 +1,29 @@
 #include <snow.h>
 
+#include <string.h>
+
 /* Fills the passed struct with the display's buffer information.
  * Note: the `address` field returned is garbage.
  */
 void snow_get_fb_info(fb_t* fb) {
-    syscall2(SYS_WM, WM_CMD_INFO, (uint32_t) fb);
+    kinfo_t info;
+
+    snow_get_kinfo(&info);
+    *fb = info.fb;
+}
+
+/* Copies the kernel info page, making sure the copy is consistent. No system
+ * call involved.
+ */
+void snow_get_kinfo(kinfo_t* info) {
+    const volatile kinfo_t* kinfo = (const volatile kinfo_t*) KINFO_ADDR;
+    uint32_t seq;
+
+    do {
+        seq = kinfo->seq;
+        memcpy(info, (const void*) kinfo, sizeof(kinfo_t));
+        asm volatile ("" ::: "memory");
+    } while (seq % 2 || seq != kinfo->seq);
 }
 
 void snow_sleep(uint32_t ms) {
@@ -100,7 +100,7 @@ void ui_set_title(ui_app_t app, const char* title) {
 
 /* Updates the UI according to the event passed in. Must be called in the
  * application's main loop, fed by events obtained through a call to
- * `snow_get_event`. Or by fake events, whatever.
+ * `snow_get_event` or `snow_wait_event`. Or by fake events, whatever.
  */
 void ui_handle_input(ui_app_t app, wm_event_t event) {
     // Will be valid in all events we care for